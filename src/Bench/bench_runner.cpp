@@ -0,0 +1,227 @@
+#include "bench_runner.hpp"
+#include "cpu_features.hpp"
+#include "sha512.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <boost/endian/conversion.hpp>
+
+#ifndef CRYPTB_VERSION
+#define CRYPTB_VERSION "unknown"
+#endif
+
+namespace
+{
+	std::string json_escape(const std::string& text)
+	{
+		std::string result;
+		for (const char character : text)
+		{
+			if (character == '"' || character == '\\')
+				result += '\\';
+			result += character;
+		}
+		return result;
+	}
+
+	// 1234.5 ns -> "1.23 us"
+	std::string format_duration(const double nanoseconds)
+	{
+		static constexpr const char* units[] = { "ns", "us", "ms", "s" };
+		double value = nanoseconds;
+		int unit = 0;
+		while (value >= 1000 && unit < 3)
+		{
+			value /= 1000;
+			++unit;
+		}
+		char buffer[32]{};
+		std::snprintf(buffer, sizeof(buffer), "%.3g %s", value, units[unit]);
+		return buffer;
+	}
+
+	volatile std::uint8_t optimization_sink = 0;
+}
+
+cryptb_bench::options cryptb_bench::options::parse(const int argc, const char* const* const argv)
+{
+	options result;
+	for (int index = 1; index < argc; ++index)
+	{
+		const std::string argument = argv[index];
+		auto next_value = [&]() -> std::string
+		{
+			if (index + 1 >= argc)
+				throw std::invalid_argument("Missing the value of \"" + argument + "\".");
+			return argv[++index];
+		};
+		if (argument == "--filter")
+			result.filter = next_value();
+		else if (argument == "--json")
+			result.json_path = next_value();
+		else if (argument == "--trace")
+			result.trace_path = next_value();
+		else if (argument == "--seed")
+			result.seed = std::stoull(next_value());
+		else if (argument == "--warmup")
+			result.warmup = std::stoi(next_value());
+		else if (argument == "--repetitions")
+			result.repetitions = std::stoi(next_value());
+		else if (argument == "--list")
+			result.list_only = true;
+		else
+			throw std::invalid_argument("Unknown argument \"" + argument + "\".");
+	}
+	return result;
+}
+
+double cryptb_bench::result::median_ns() const
+{
+	if (this->ns_per_op.empty())
+		return 0;
+	const std::size_t middle = this->ns_per_op.size() / 2;
+	if (this->ns_per_op.size() % 2 == 1)
+		return this->ns_per_op[middle];
+	return (this->ns_per_op[middle - 1] + this->ns_per_op[middle]) / 2;
+}
+
+double cryptb_bench::result::p99_ns() const
+{
+	if (this->ns_per_op.empty())
+		return 0;
+	const std::size_t rank = static_cast<std::size_t>(std::ceil(0.99 * static_cast<double>(this->ns_per_op.size())));
+	return this->ns_per_op[std::max<std::size_t>(rank, 1) - 1];
+}
+
+double cryptb_bench::result::mean_ns() const
+{
+	if (this->ns_per_op.empty())
+		return 0;
+	return std::accumulate(this->ns_per_op.cbegin(), this->ns_per_op.cend(), 0.0) / static_cast<double>(this->ns_per_op.size());
+}
+
+bool cryptb_bench::runner::is_selected(const std::string& name) const
+{
+	if (name.find(this->m_options.filter) == std::string::npos)
+		return false;
+	if (this->m_options.list_only)
+	{
+		std::cout << name << std::endl;
+		return false;
+	}
+	return true;
+}
+
+cryptb::random_engine cryptb_bench::runner::make_engine(std::string_view label) const
+{
+	// SHA-512("cryptb_bench" || seed || label || block index) for as many blocks as the seed needs
+	std::array<std::uint8_t, cryptb::random_engine::optimal_seed_size_bytes> seed_bytes{ {0} };
+	static constexpr char prefix[] = "cryptb_bench";
+	for (std::size_t offset = 0, block = 0; offset < seed_bytes.size(); ++block)
+	{
+		std::uint8_t numbers[16]{};
+		boost::endian::store_big_u64(numbers, this->m_options.seed);
+		boost::endian::store_big_u64(numbers + 8, static_cast<std::uint64_t>(block));
+		cryptb::sha512 hash{ reinterpret_cast<const std::uint8_t*>(prefix), sizeof(prefix) - 1 };
+		hash.update(numbers, 8);
+		hash.update(reinterpret_cast<const std::uint8_t*>(label.data()), label.size());
+		hash.update(numbers + 8, 8);
+		const cryptb::sha512::digest_t digest = hash.digest();
+		const std::size_t num_bytes = std::min(digest.size(), seed_bytes.size() - offset);
+		std::copy(digest.cbegin(), digest.cbegin() + num_bytes, seed_bytes.begin() + offset);
+		offset += num_bytes;
+	}
+	return cryptb::random_engine{ seed_bytes };
+}
+
+void cryptb_bench::runner::add_result(result current)
+{
+	std::sort(current.ns_per_op.begin(), current.ns_per_op.end());
+	std::cout << current.name
+		<< "  median " << format_duration(current.median_ns())
+		<< "  p99 " << format_duration(current.p99_ns());
+	if (current.config.bytes_per_op != 0 && current.median_ns() > 0)
+	{
+		const double megabytes_per_second = static_cast<double>(current.config.bytes_per_op) * 1e3 / current.median_ns();
+		std::cout << "  " << megabytes_per_second << " MB/s";
+	}
+	std::cout << "  (" << current.config.repetitions << " x " << current.config.ops_per_repetition << " ops)" << std::endl;
+	this->m_results.push_back(std::move(current));
+}
+
+void cryptb_bench::runner::finish() const
+{
+	auto open = [](const std::string& path) -> std::ofstream
+	{
+		std::ofstream file{ path };
+		if (!file)
+			throw std::runtime_error("Failed to open \"" + path + "\" for writing.");
+		return file;
+	};
+	if (!this->m_options.json_path.empty())
+	{
+		std::ofstream file = open(this->m_options.json_path);
+		this->write_json(file);
+	}
+	if (cryptb::trace::is_enabled)
+	{
+		std::cout << std::endl;
+		cryptb::trace::write_percentiles(std::cout);
+	}
+	if (!this->m_options.trace_path.empty())
+	{
+		if (!cryptb::trace::is_enabled)
+			std::cerr << "Warning: --trace needs a build with CRYPTB_WITH_TRACING, the trace is empty." << std::endl;
+		std::ofstream file = open(this->m_options.trace_path);
+		cryptb::trace::write_chrome_trace(file);
+	}
+}
+
+void cryptb_bench::runner::write_json(std::ostream& out) const
+{
+	const cryptb::cpu_features& features = cryptb::cpu_features::get();
+	out << "{\n";
+	out << "  \"cryptb_version\": \"" << CRYPTB_VERSION << "\",\n";
+#ifdef __VERSION__
+	out << "  \"compiler\": \"" << json_escape(__VERSION__) << "\",\n";
+#endif
+	out << "  \"cpu_features\": {\"bmi2\": " << std::boolalpha << features.bmi2
+		<< ", \"avx2\": " << features.avx2
+		<< ", \"avx512f\": " << features.avx512f << "},\n";
+	out << "  \"seed\": " << this->m_options.seed << ",\n";
+	out << "  \"results\": [";
+	for (std::size_t index = 0; index < this->m_results.size(); ++index)
+	{
+		const result& current = this->m_results[index];
+		out << (index == 0 ? "\n" : ",\n");
+		out << "    {\"name\": \"" << json_escape(current.name) << "\""
+			<< ", \"warmup\": " << current.config.warmup
+			<< ", \"repetitions\": " << current.config.repetitions
+			<< ", \"ops_per_repetition\": " << current.config.ops_per_repetition
+			<< ", \"bytes_per_op\": " << current.config.bytes_per_op
+			<< ", \"median_ns\": " << current.median_ns()
+			<< ", \"p99_ns\": " << current.p99_ns()
+			<< ", \"mean_ns\": " << current.mean_ns()
+			<< ", \"min_ns\": " << current.ns_per_op.front()
+			<< ", \"max_ns\": " << current.ns_per_op.back()
+			<< "}";
+	}
+	out << "\n  ]\n}\n";
+}
+
+void cryptb_bench::do_not_optimize(const void* const data, const std::size_t len)
+{
+	const std::uint8_t* const bytes = static_cast<const std::uint8_t*>(data);
+	std::uint8_t folded = 0;
+	for (std::size_t index = 0; index < len; ++index)
+	{
+		folded ^= bytes[index];
+	}
+	optimization_sink = optimization_sink ^ folded;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "random_engine.hpp"
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cryptb_bench
+{
+	struct options
+	{
+		// Only run the benchmarks whose name contains this
+		std::string filter;
+		// Empty means no JSON file
+		std::string json_path;
+		// The Chrome trace of the most recent traced calls (see trace.hpp), empty means none
+		std::string trace_path;
+		// Mixed into the seed of every benchmark. The same value always gives the same inputs (and keys).
+		std::uint64_t seed = 0;
+		// When not negative, replace the numbers of every benchmark
+		int warmup = -1;
+		int repetitions = -1;
+		bool list_only = false;
+
+		// Throws std::invalid_argument for arguments it doesn't know.
+		static options parse(const int argc, const char* const* const argv);
+	};
+
+	struct run_config
+	{
+		// Untimed runs before the timed ones (fills the caches, trains the branch predictors, ...)
+		int warmup = 1;
+		// Timed runs. The median and the 99th percentile are over these.
+		int repetitions = 10;
+		// How many operations every run does. The reported times are per operation.
+		std::uint64_t ops_per_repetition = 1;
+		// For the throughput, 0 when a throughput makes no sense
+		std::uint64_t bytes_per_op = 0;
+	};
+
+	struct result
+	{
+		std::string name;
+		run_config config;
+		// Nanoseconds per operation of every timed run, sorted
+		std::vector<double> ns_per_op;
+
+		double median_ns() const;
+		// Nearest rank, so with less than 100 repetitions it's the slowest one
+		double p99_ns() const;
+		double mean_ns() const;
+	};
+
+	class runner
+	{
+		options m_options;
+		std::vector<result> m_results;
+
+	public:
+		explicit runner(options opts) : m_options(std::move(opts)) {}
+
+		// Whether the benchmark "name" should run. Check before doing any expensive setup for it.
+		// With "--list" this prints the name and returns false.
+		bool is_selected(const std::string& name) const;
+
+		// Deterministic engine for the benchmark (or the key) called "label":
+		// the seed is derived from "label" and the --seed option only.
+		cryptb::random_engine make_engine(std::string_view label) const;
+
+		// Runs "body" config.warmup times untimed and config.repetitions times timed.
+		// Every call of "body" has to do config.ops_per_repetition operations.
+		// Prints the result right away.
+		template <typename body_T>
+		void run(const std::string& name, run_config config, body_T&& body)
+		{
+			if (!this->is_selected(name))
+				return;
+			if (this->m_options.warmup >= 0)
+				config.warmup = this->m_options.warmup;
+			if (this->m_options.repetitions > 0)
+				config.repetitions = this->m_options.repetitions;
+			for (int index = 0; index < config.warmup; ++index)
+			{
+				body();
+			}
+			result current;
+			current.name = name;
+			current.config = config;
+			current.ns_per_op.reserve(config.repetitions);
+			for (int index = 0; index < config.repetitions; ++index)
+			{
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				body();
+				const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+				const double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+				current.ns_per_op.push_back(nanoseconds / static_cast<double>(config.ops_per_repetition));
+			}
+			this->add_result(std::move(current));
+		}
+
+		// Writes the JSON file when --json was given.
+		// With CRYPTB_WITH_TRACING also prints the latency percentiles of the traced calls
+		// and writes the Chrome trace when --trace was given.
+		void finish() const;
+
+		void write_json(std::ostream& out) const;
+
+	private:
+		void add_result(result current);
+	};
+
+	// Keeps the compiler from optimizing away a computation whose result isn't used otherwise.
+	void do_not_optimize(const void* const data, const std::size_t len);
+
+	template <typename T>
+	void do_not_optimize(const T& value)
+	{
+		do_not_optimize(&value, sizeof(value));
+	}
+}
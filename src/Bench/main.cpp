@@ -0,0 +1,620 @@
+#include "bench_runner.hpp"
+#include "concurrent_random_engine.hpp"
+#include "hmac_sha512.hpp"
+#include "modinv.hpp"
+#include "prime.hpp"
+#include "public_key_cache.hpp"
+#include "rsa.hpp"
+#include "sha512.hpp"
+#include "sha512_multi.hpp"
+#include "sha512_tree.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Benchmarks for every primitive of the library. See README.md for the command line.
+//
+// Every input (and every key) comes from a random_engine that is seeded from the name
+// of the benchmark and the --seed option, so two runs with the same options measure
+// exactly the same work and can be compared between releases.
+
+namespace
+{
+	using cryptb_bench::run_config;
+	using cryptb_bench::runner;
+	using boost::multiprecision::cpp_int;
+
+	constexpr int rsa_sizes[] = { 1024, 2048, 3072, 4096 };
+
+	std::string to_string(const cryptb::sha512::compress_implementation implementation)
+	{
+		return implementation == cryptb::sha512::compress_implementation::avx2 ? "avx2" : "scalar";
+	}
+
+	std::string to_string(const cryptb::sha512_multi::implementation implementation)
+	{
+		switch (implementation)
+		{
+		case cryptb::sha512_multi::implementation::avx2:
+			return "avx2";
+		case cryptb::sha512_multi::implementation::avx512:
+			return "avx512";
+		default:
+			return "scalar";
+		}
+	}
+
+	std::vector<std::uint8_t> random_bytes(cryptb::random_engine& engine, const std::size_t num_bytes)
+	{
+		std::vector<std::uint8_t> result(num_bytes);
+		engine.fill(result);
+		return result;
+	}
+
+	// Keys are generated once (deterministically) and shared by all of the benchmarks that need them.
+	class key_store
+	{
+		const runner& m_runner;
+		std::map<std::pair<int, int>, cryptb::rsa> m_keys;
+
+	public:
+		explicit key_store(const runner& bench_runner) : m_runner(bench_runner) {}
+
+		const cryptb::rsa& get(const int num_bits, const int num_primes = 2)
+		{
+			const std::pair<int, int> key_id{ num_bits, num_primes };
+			auto found = this->m_keys.find(key_id);
+			if (found == this->m_keys.end())
+			{
+				cryptb::random_engine engine = this->m_runner.make_engine(
+					"key/" + std::to_string(num_bits) + "/primes=" + std::to_string(num_primes));
+				found = this->m_keys.emplace(key_id, cryptb::rsa{ engine, num_bits / 8 / num_primes, 1, num_primes }).first;
+			}
+			return found->second;
+		}
+	};
+
+	// The same key with another number type
+	template <typename int_T>
+	cryptb::basic_rsa<int_T> convert_key(const cryptb::rsa& key)
+	{
+		auto to = [](const cpp_int& num) -> int_T
+		{
+			return static_cast<int_T>(num);
+		};
+		std::vector<typename cryptb::basic_rsa<int_T>::other_prime_info> other_primes;
+		for (const cryptb::rsa::other_prime_info& other : key.get_other_primes())
+		{
+			other_primes.push_back({ to(other.r), to(other.d), to(other.t) });
+		}
+		return cryptb::basic_rsa<int_T>(to(key.get_e()), to(key.get_d()), to(key.get_N()),
+			to(key.get_p()), to(key.get_q()), to(key.get_dP()), to(key.get_dQ()), to(key.get_qInv()),
+			std::move(other_primes));
+	}
+
+	// The extended Euclid that basic_rsa used to compute d with (before cryptb::modinv),
+	// kept here as the baseline of the modinv benchmark.
+	cpp_int legacy_findd(const cpp_int& PhiN, const cpp_int& e)
+	{
+		struct euclid_step
+		{
+			cpp_int a = 0, b = 0, quotient = 0;
+		};
+		std::vector<euclid_step> steps_of_euclid;
+		cpp_int a = PhiN;
+		cpp_int b = e;
+		while (true)
+		{
+			cpp_int remainder = a % b;
+			if (remainder == 0)
+				break;
+			euclid_step current_step;
+			current_step.a = std::move(a);
+			current_step.b = std::move(b);
+			current_step.quotient = current_step.a / current_step.b;
+			steps_of_euclid.push_back(current_step);
+			a = current_step.b;
+			b = std::move(remainder);
+		}
+		if (steps_of_euclid.empty())
+			return 0;
+		euclid_step first_step = std::move(steps_of_euclid.back());
+		std::pair<cpp_int, cpp_int> valueA{ std::move(first_step.a), 1 };
+		std::pair<cpp_int, cpp_int> valueB{ std::move(first_step.b), -std::move(first_step.quotient) };
+		steps_of_euclid.pop_back();
+		for (bool BSmaller = true; !steps_of_euclid.empty(); steps_of_euclid.pop_back())
+		{
+			euclid_step current_step = std::move(steps_of_euclid.back());
+			if (BSmaller)
+			{
+				BSmaller = false;
+				valueA.second = std::move(valueA.second) + valueB.second * (-std::move(current_step.quotient));
+				valueB.first = std::move(current_step.a);
+			}
+			else
+			{
+				BSmaller = true;
+				valueB.second = std::move(valueB.second) + valueA.second * (-std::move(current_step.quotient));
+				valueA.first = std::move(current_step.a);
+			}
+		}
+		cpp_int d = valueA.first > valueB.first ? std::move(valueB.second) % PhiN : std::move(valueA.second) % PhiN;
+		if (d < 0)
+			d += PhiN;
+		return d;
+	}
+
+	void bench_sha512(runner& bench)
+	{
+		const cryptb::sha512::compress_implementation original = cryptb::sha512::get_compress_implementation();
+		for (const cryptb::sha512::compress_implementation implementation : { cryptb::sha512::compress_implementation::scalar, cryptb::sha512::compress_implementation::avx2 })
+		{
+			if (!cryptb::sha512::is_supported(implementation))
+				continue;
+			cryptb::sha512::set_compress_implementation(implementation);
+			const std::string suffix = "/" + to_string(implementation);
+			struct message_size
+			{
+				const char* label;
+				std::size_t num_bytes;
+				std::uint64_t ops_per_repetition;
+			};
+			for (const message_size size : { message_size{ "64B", 64, 20000 }, message_size{ "4KiB", 4096, 1000 }, message_size{ "1MiB", 1 << 20, 5 } })
+			{
+				const std::string name = std::string("sha512/update_digest/") + size.label + suffix;
+				if (!bench.is_selected(name))
+					continue;
+				cryptb::random_engine engine = bench.make_engine(name);
+				const std::vector<std::uint8_t> message = random_bytes(engine, size.num_bytes);
+				bench.run(name, run_config{ 1, 10, size.ops_per_repetition, size.num_bytes }, [&]() -> void
+				{
+					for (std::uint64_t op = 0; op < size.ops_per_repetition; ++op)
+					{
+						cryptb::sha512 hash;
+						hash.update(message.data(), message.size());
+						cryptb_bench::do_not_optimize(hash.digest());
+					}
+				});
+			}
+			// 1 GiB streamed through a 1 MiB buffer, like hashing a large file that's already in memory
+			const std::string name = "sha512/update_digest/1GiB" + suffix;
+			if (bench.is_selected(name))
+			{
+				cryptb::random_engine engine = bench.make_engine(name);
+				const std::vector<std::uint8_t> chunk = random_bytes(engine, 1 << 20);
+				bench.run(name, run_config{ 0, 3, 1, std::uint64_t{ 1 } << 30 }, [&]() -> void
+				{
+					cryptb::sha512 hash;
+					for (int index = 0; index < 1024; ++index)
+					{
+						hash.update(chunk.data(), chunk.size());
+					}
+					cryptb_bench::do_not_optimize(hash.digest());
+				});
+			}
+		}
+		cryptb::sha512::set_compress_implementation(original);
+
+		for (const cryptb::sha512_multi::implementation implementation : { cryptb::sha512_multi::implementation::scalar, cryptb::sha512_multi::implementation::avx2, cryptb::sha512_multi::implementation::avx512 })
+		{
+			const std::string name = "sha512_multi/digest/64B/" + to_string(implementation);
+			if (!cryptb::sha512_multi::is_supported(implementation) || !bench.is_selected(name))
+				continue;
+			constexpr std::size_t num_messages = 4096;
+			cryptb::random_engine engine = bench.make_engine(name);
+			const std::vector<std::uint8_t> data = random_bytes(engine, num_messages * 64);
+			std::vector<cryptb::sha512_multi::message> messages(num_messages);
+			for (std::size_t index = 0; index < num_messages; ++index)
+			{
+				messages[index] = cryptb::sha512_multi::message{ data.data() + index * 64, 64 };
+			}
+			std::vector<cryptb::sha512::digest_t> digests(num_messages);
+			bench.run(name, run_config{ 1, 10, num_messages, 64 }, [&]() -> void
+			{
+				cryptb::sha512_multi::digest(messages, digests, implementation);
+				cryptb_bench::do_not_optimize(digests.back());
+			});
+		}
+
+		{
+			cryptb::thread_pool pool;
+			const std::string name = "sha512_tree/hash/64MiB/threads=" + std::to_string(pool.size());
+			if (bench.is_selected(name))
+			{
+				cryptb::random_engine engine = bench.make_engine(name);
+				const std::vector<std::uint8_t> data = random_bytes(engine, 64 << 20);
+				bench.run(name, run_config{ 1, 5, 1, data.size() }, [&]() -> void
+				{
+					cryptb_bench::do_not_optimize(cryptb::sha512_tree::hash(data, pool));
+				});
+			}
+		}
+
+		{
+			const std::string name = "hmac_sha512/digest/64B";
+			if (bench.is_selected(name))
+			{
+				cryptb::random_engine engine = bench.make_engine(name);
+				const std::vector<std::uint8_t> key = random_bytes(engine, 64);
+				const std::vector<std::uint8_t> message = random_bytes(engine, 64);
+				const cryptb::hmac_sha512 hmac{ key.data(), key.size() };
+				bench.run(name, run_config{ 1, 10, 10000, 64 }, [&]() -> void
+				{
+					for (int op = 0; op < 10000; ++op)
+					{
+						cryptb_bench::do_not_optimize(hmac.digest(message.data(), message.size()));
+					}
+				});
+			}
+		}
+	}
+
+	void bench_random(runner& bench)
+	{
+		for (const int num_bytes : { 64, 256 })
+		{
+			const std::string name = "random_engine/operator()/" + std::to_string(num_bytes) + "B";
+			if (!bench.is_selected(name))
+				continue;
+			cryptb::random_engine engine = bench.make_engine(name);
+			bench.run(name, run_config{ 1, 10, 2000, static_cast<std::uint64_t>(num_bytes) }, [&]() -> void
+			{
+				for (int op = 0; op < 2000; ++op)
+				{
+					cryptb_bench::do_not_optimize(engine(num_bytes));
+				}
+			});
+		}
+		{
+			const std::string name = "random_engine/gen_512_bit_random_number";
+			cryptb::random_engine engine = bench.make_engine(name);
+			bench.run(name, run_config{ 1, 10, 5000, 64 }, [&]() -> void
+			{
+				for (int op = 0; op < 5000; ++op)
+				{
+					cryptb_bench::do_not_optimize(engine.gen_512_bit_random_number());
+				}
+			});
+		}
+		{
+			const std::string name = "random_engine/fill/1MiB";
+			cryptb::random_engine engine = bench.make_engine(name);
+			std::vector<std::uint8_t> output(1 << 20);
+			bench.run(name, run_config{ 1, 10, 1, output.size() }, [&]() -> void
+			{
+				engine.fill(output);
+				cryptb_bench::do_not_optimize(output.back());
+			});
+		}
+		{
+			const std::string name = "random_engine/generate_into/4096bit/fixed_uint";
+			cryptb::random_engine engine = bench.make_engine(name);
+			cryptb::fixed_uint<4096> number;
+			bench.run(name, run_config{ 1, 10, 2000, 512 }, [&]() -> void
+			{
+				for (int op = 0; op < 2000; ++op)
+				{
+					engine.generate_into(number, 4096);
+					cryptb_bench::do_not_optimize(number);
+				}
+			});
+		}
+		// Thread scaling: every thread takes numbers from its own shard
+		const int max_threads = std::max(8, static_cast<int>(std::thread::hardware_concurrency()));
+		for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+		{
+			const std::string name = "concurrent_random_engine/gen_512_bit_random_number/threads=" + std::to_string(num_threads);
+			if (!bench.is_selected(name))
+				continue;
+			constexpr int ops_per_thread = 5000;
+			cryptb::concurrent_random_engine engine{ bench.make_engine(name) };
+			bench.run(name, run_config{ 1, 5, static_cast<std::uint64_t>(ops_per_thread) * num_threads, 64 }, [&]() -> void
+			{
+				std::vector<std::thread> threads;
+				for (int index = 0; index < num_threads; ++index)
+				{
+					threads.emplace_back([&engine]() -> void
+					{
+						for (int op = 0; op < ops_per_thread; ++op)
+						{
+							cryptb_bench::do_not_optimize(engine.gen_512_bit_random_number());
+						}
+					});
+				}
+				for (std::thread& thread : threads)
+				{
+					thread.join();
+				}
+			});
+		}
+	}
+
+	template <typename int_T>
+	void bench_prime(runner& bench, const std::string& backend)
+	{
+		const cryptb::primality_test original = cryptb::basic_prime<int_T>::get_primality_test();
+		for (const int num_bytes : { 32, 64, 96, 128, 192, 256 })
+		{
+			for (const cryptb::primality_test test : { cryptb::primality_test::miller_rabin, cryptb::primality_test::baillie_psw })
+			{
+				const std::string size = "prime/gen_random/" + std::to_string(num_bytes) + "B/";
+				const std::string name = size + (test == cryptb::primality_test::miller_rabin ? "miller_rabin/" : "baillie_psw/") + backend;
+				if (!bench.is_selected(name))
+					continue;
+				cryptb::basic_prime<int_T>::set_primality_test(test);
+				// The same candidates for both tests
+				cryptb::random_engine engine = bench.make_engine(size + backend);
+				bench.run(name, run_config{ num_bytes <= 64 ? 1 : 0, num_bytes <= 128 ? 10 : 3, 1, 0 }, [&]() -> void
+				{
+					cryptb_bench::do_not_optimize(cryptb::basic_prime<int_T>::gen_random(num_bytes, engine));
+				});
+			}
+		}
+		cryptb::basic_prime<int_T>::set_primality_test(original);
+	}
+
+	template <typename int_T>
+	void bench_keygen(runner& bench, const std::string& backend)
+	{
+		for (const int num_bits : rsa_sizes)
+		{
+			const std::string name = "rsa/keygen/" + std::to_string(num_bits) + "/" + backend;
+			if (!bench.is_selected(name))
+				continue;
+			cryptb::random_engine engine = bench.make_engine(name);
+			bench.run(name, run_config{ num_bits <= 2048 ? 1 : 0, num_bits <= 2048 ? 5 : 3, 1, 0 }, [&]() -> void
+			{
+				const cryptb::basic_rsa<int_T> key{ engine, num_bits / 16 };
+				cryptb_bench::do_not_optimize(key.get_N());
+			});
+		}
+		for (const int num_primes : { 3, 4 })
+		{
+			const std::string name = "rsa/keygen/4096/primes=" + std::to_string(num_primes) + "/" + backend;
+			if (!bench.is_selected(name))
+				continue;
+			cryptb::random_engine engine = bench.make_engine(name);
+			bench.run(name, run_config{ 0, 3, 1, 0 }, [&]() -> void
+			{
+				const cryptb::basic_rsa<int_T> key{ engine, 4096 / 8 / num_primes, 1, num_primes };
+				cryptb_bench::do_not_optimize(key.get_N());
+			});
+		}
+	}
+
+	// encrypt, decrypt, sign and is_valid_signature of one key size with one number type
+	template <typename int_T>
+	void bench_rsa_operations(runner& bench, key_store& keys, const int num_bits, const std::string& backend)
+	{
+		const std::string size = "/" + std::to_string(num_bits) + "/" + backend;
+		const std::string names[] = { "rsa/encrypt" + size, "rsa/decrypt" + size, "rsa/sign" + size, "rsa/is_valid_signature" + size };
+		if (std::none_of(std::cbegin(names), std::cend(names), [&bench](const std::string& name) { return bench.is_selected(name); }))
+			return;
+		const cryptb::basic_rsa<int_T> key = convert_key<int_T>(keys.get(num_bits));
+		cryptb::random_engine engine = bench.make_engine("message" + size);
+		const int_T message = static_cast<int_T>(engine(num_bits / 8 - 1));
+		const int_T encrypted = cryptb::basic_rsa<int_T>::encrypt(message, key.get_e(), key.get_N()).get();
+		const int_T signature = key.sign(message).get();
+		const int private_repetitions = num_bits <= 2048 ? 20 : 10;
+
+		bench.run(names[0], run_config{ 1, 10, 20, 0 }, [&]() -> void
+		{
+			for (int op = 0; op < 20; ++op)
+			{
+				cryptb_bench::do_not_optimize(cryptb::basic_rsa<int_T>::encrypt(message, key.get_e(), key.get_N()));
+			}
+		});
+		bench.run(names[1], run_config{ 1, private_repetitions, 1, 0 }, [&]() -> void
+		{
+			cryptb_bench::do_not_optimize(key.decrypt(encrypted));
+		});
+		bench.run(names[2], run_config{ 1, private_repetitions, 1, 0 }, [&]() -> void
+		{
+			cryptb_bench::do_not_optimize(key.sign(message));
+		});
+		bench.run(names[3], run_config{ 1, 10, 20, 0 }, [&]() -> void
+		{
+			for (int op = 0; op < 20; ++op)
+			{
+				cryptb_bench::do_not_optimize(cryptb::basic_rsa<int_T>::is_valid_signature(message, signature, key.get_e(), key.get_N()));
+			}
+		});
+	}
+
+	// Multi-prime keys, the sign of 4096-bit keys with 2, 3 and 4 primes
+	template <typename int_T>
+	void bench_multi_prime_sign(runner& bench, key_store& keys, const std::string& backend)
+	{
+		for (const int num_primes : { 2, 3, 4 })
+		{
+			const std::string name = "rsa/sign/4096/primes=" + std::to_string(num_primes) + "/" + backend;
+			if (!bench.is_selected(name))
+				continue;
+			const cryptb::basic_rsa<int_T> key = convert_key<int_T>(keys.get(4096, num_primes));
+			cryptb::random_engine engine = bench.make_engine(name);
+			const int_T message = static_cast<int_T>(engine(4096 / 8 - 1));
+			bench.run(name, run_config{ 1, 10, 1, 0 }, [&]() -> void
+			{
+				cryptb_bench::do_not_optimize(key.sign(message));
+			});
+		}
+	}
+
+	// Verifying with the per-key work cached (compare with rsa/is_valid_signature)
+	template <typename int_T>
+	void bench_public_key_cache(runner& bench, key_store& keys, const std::string& backend)
+	{
+		const std::string name = "public_key_cache/is_valid_signature/2048/" + backend;
+		if (!bench.is_selected(name))
+			return;
+		const cryptb::basic_rsa<int_T> key = convert_key<int_T>(keys.get(2048));
+		cryptb::random_engine engine = bench.make_engine(name);
+		const int_T message = static_cast<int_T>(engine(2048 / 8 - 1));
+		const int_T signature = key.sign(message).get();
+		cryptb::basic_public_key_cache<int_T> cache{ 1024 };
+		bench.run(name, run_config{ 1, 10, 20, 0 }, [&]() -> void
+		{
+			for (int op = 0; op < 20; ++op)
+			{
+				cryptb_bench::do_not_optimize(cache.is_valid_signature(message, signature, key.get_e(), key.get_N()));
+			}
+		});
+	}
+
+	void bench_sign_batch(runner& bench, key_store& keys)
+	{
+		const int max_threads = std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+		for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+		{
+			const std::string name = "rsa/sign_batch/2048/threads=" + std::to_string(num_threads) + "/fixed_uint";
+			if (!bench.is_selected(name))
+				continue;
+			const cryptb::rsa2048 key = convert_key<cryptb::fixed_uint<2048>>(keys.get(2048));
+			cryptb::random_engine engine = bench.make_engine(name);
+			constexpr std::size_t batch_size = 64;
+			std::vector<cryptb::fixed_uint<2048>> hashes;
+			for (std::size_t index = 0; index < batch_size; ++index)
+			{
+				hashes.push_back(static_cast<cryptb::fixed_uint<2048>>(engine(2048 / 8 - 1)));
+			}
+			std::vector<cryptb::fixed_uint<2048>> signatures(batch_size);
+			cryptb::thread_pool pool{ num_threads };
+			bench.run(name, run_config{ 1, 5, batch_size, 0 }, [&]() -> void
+			{
+				key.sign_batch(hashes, signatures, pool);
+				cryptb_bench::do_not_optimize(signatures.back());
+			});
+		}
+	}
+
+	template <typename int_T>
+	void bench_modinv(runner& bench, const int num_bits, const std::string& backend)
+	{
+		const std::string name = "modinv/" + std::to_string(num_bits) + "/" + backend;
+		if (!bench.is_selected(name))
+			return;
+		// The same (a, modulus) pair for every backend of this size
+		cryptb::random_engine engine = bench.make_engine("modinv/" + std::to_string(num_bits));
+		cpp_int modulus, a;
+		do
+		{
+			modulus = engine(num_bits / 8);
+			boost::multiprecision::bit_set(modulus, num_bits - 1);
+			a = engine(num_bits / 8) % modulus;
+		} while (boost::multiprecision::gcd(a, modulus) != 1);
+		const int_T modulus_number = static_cast<int_T>(modulus);
+		const int_T a_number = static_cast<int_T>(a);
+		bench.run(name, run_config{ 1, 10, 20, 0 }, [&]() -> void
+		{
+			for (int op = 0; op < 20; ++op)
+			{
+				cryptb_bench::do_not_optimize(cryptb::modinv(a_number, modulus_number));
+			}
+		});
+	}
+
+	void bench_legacy_findd(runner& bench, const int num_bits)
+	{
+		const std::string name = "modinv/" + std::to_string(num_bits) + "/legacy_findd";
+		if (!bench.is_selected(name))
+			return;
+		cryptb::random_engine engine = bench.make_engine("modinv/" + std::to_string(num_bits));
+		cpp_int modulus, a;
+		do
+		{
+			modulus = engine(num_bits / 8);
+			boost::multiprecision::bit_set(modulus, num_bits - 1);
+			a = engine(num_bits / 8) % modulus;
+		} while (boost::multiprecision::gcd(a, modulus) != 1);
+		bench.run(name, run_config{ 1, 10, 20, 0 }, [&]() -> void
+		{
+			for (int op = 0; op < 20; ++op)
+			{
+				cryptb_bench::do_not_optimize(legacy_findd(modulus, a));
+			}
+		});
+	}
+
+	void bench_all(runner& bench)
+	{
+		key_store keys{ bench };
+
+		bench_sha512(bench);
+		bench_random(bench);
+
+		for (const int num_bits : { 1024, 2048, 4096, 8192 })
+		{
+			bench_legacy_findd(bench, num_bits);
+			bench_modinv<cpp_int>(bench, num_bits, "cpp_int");
+#ifdef CRYPTB_WITH_GMP
+			bench_modinv<boost::multiprecision::mpz_int>(bench, num_bits, "gmp");
+#endif
+		}
+		bench_modinv<cryptb::fixed_uint<1024>>(bench, 1024, "fixed_uint");
+		bench_modinv<cryptb::fixed_uint<2048>>(bench, 2048, "fixed_uint");
+		bench_modinv<cryptb::fixed_uint<4096>>(bench, 4096, "fixed_uint");
+
+		bench_prime<cpp_int>(bench, "cpp_int");
+#ifdef CRYPTB_WITH_GMP
+		bench_prime<boost::multiprecision::mpz_int>(bench, "gmp");
+#endif
+
+		// Fixed-width keys are generated with cpp_int, so there's no separate fixed_uint keygen.
+		bench_keygen<cpp_int>(bench, "cpp_int");
+#ifdef CRYPTB_WITH_GMP
+		bench_keygen<boost::multiprecision::mpz_int>(bench, "gmp");
+#endif
+
+		for (const int num_bits : rsa_sizes)
+		{
+			bench_rsa_operations<cpp_int>(bench, keys, num_bits, "cpp_int");
+#ifdef CRYPTB_WITH_GMP
+			bench_rsa_operations<boost::multiprecision::mpz_int>(bench, keys, num_bits, "gmp");
+#endif
+		}
+		bench_rsa_operations<cryptb::fixed_uint<1024>>(bench, keys, 1024, "fixed_uint");
+		bench_rsa_operations<cryptb::fixed_uint<2048>>(bench, keys, 2048, "fixed_uint");
+		bench_rsa_operations<cryptb::fixed_uint<3072>>(bench, keys, 3072, "fixed_uint");
+		bench_rsa_operations<cryptb::fixed_uint<4096>>(bench, keys, 4096, "fixed_uint");
+
+		bench_multi_prime_sign<cpp_int>(bench, keys, "cpp_int");
+		bench_multi_prime_sign<cryptb::fixed_uint<4096>>(bench, keys, "fixed_uint");
+#ifdef CRYPTB_WITH_GMP
+		bench_multi_prime_sign<boost::multiprecision::mpz_int>(bench, keys, "gmp");
+#endif
+
+		bench_sign_batch(bench, keys);
+
+		bench_public_key_cache<cpp_int>(bench, keys, "cpp_int");
+		bench_public_key_cache<cryptb::fixed_uint<2048>>(bench, keys, "fixed_uint");
+#ifdef CRYPTB_WITH_GMP
+		bench_public_key_cache<boost::multiprecision::mpz_int>(bench, keys, "gmp");
+#endif
+	}
+}
+
+int main(int argc, char** argv)
+{
+#ifndef NDEBUG
+	std::cerr << "Warning: cryptb_bench was built without optimizations (configure with -DCMAKE_BUILD_TYPE=Release)." << std::endl;
+#endif
+	try
+	{
+		runner bench{ cryptb_bench::options::parse(argc, argv) };
+		bench_all(bench);
+		bench.finish();
+	}
+	catch (const std::exception& error)
+	{
+		std::cerr << error.what() << std::endl;
+		std::cerr << "Usage: cryptb_bench [--filter <substring>] [--json <file>] [--trace <file>] [--seed <number>]"
+			" [--warmup <count>] [--repetitions <count>] [--list]" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,106 @@
+#include "rsa.hpp"
+#include "prime.hpp"
+#include "random_engine.hpp"
+#include <boost/multiprecision/miller_rabin.hpp>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The GMP backend (CRYPTB_WITH_GMP): prime generation with mpz_int, and gmp_rsa keys
+// (two primes and multi-prime) through sign / is_valid_signature and encrypt / decrypt.
+// The signatures must also be the same as the ones of the same key in cpp_int.
+
+namespace
+{
+	using boost::multiprecision::cpp_int;
+	using boost::multiprecision::mpz_int;
+
+	int num_failures = 0;
+
+	void check(const bool condition, const std::string& what)
+	{
+		if (condition)
+			return;
+		std::cerr << "FAILED: " << what << std::endl;
+		++num_failures;
+	}
+
+	cpp_int to_cpp_int(const mpz_int& value)
+	{
+		return cpp_int(value.str());
+	}
+
+	void check_prime(cryptb::random_engine& engine)
+	{
+		constexpr int num_bytes = 64;
+		const mpz_int prime = cryptb::basic_prime<mpz_int>::gen_random(num_bytes, engine);
+		check(boost::multiprecision::msb(prime) == num_bytes * 8 - 1, "basic_prime<mpz_int>::gen_random has the requested size");
+		check(boost::multiprecision::miller_rabin_test(prime, 25), "basic_prime<mpz_int>::gen_random is prime");
+	}
+
+	void check_key(cryptb::random_engine& engine, const int num_bytes_in_prime_number, const int num_primes)
+	{
+		const std::string name = "gmp_rsa with " + std::to_string(num_primes) + " primes of "
+			+ std::to_string(num_bytes_in_prime_number) + " bytes";
+		const cryptb::gmp_rsa key{ engine, num_bytes_in_prime_number, 1, num_primes };
+		const int num_bytes_in_N = num_bytes_in_prime_number * num_primes;
+		check(boost::multiprecision::msb(key.get_N()) == num_bytes_in_N * 8 - 1, name + ": N has the requested size");
+
+		// The same key in cpp_int, for comparing the signatures
+		std::vector<cryptb::rsa::other_prime_info> other_primes;
+		for (const cryptb::gmp_rsa::other_prime_info& other : key.get_other_primes())
+		{
+			other_primes.push_back(cryptb::rsa::other_prime_info{ to_cpp_int(other.r), to_cpp_int(other.d), to_cpp_int(other.t) });
+		}
+		const cryptb::rsa cpp_int_key{ to_cpp_int(key.get_e()), to_cpp_int(key.get_d()), to_cpp_int(key.get_N()),
+			to_cpp_int(key.get_p()), to_cpp_int(key.get_q()),
+			to_cpp_int(key.get_dP()), to_cpp_int(key.get_dQ()), to_cpp_int(key.get_qInv()),
+			std::move(other_primes) };
+
+		for (int index = 0; index < 8; ++index)
+		{
+			// One byte shorter than N, so always smaller than N
+			const mpz_int message = engine.operator()<mpz_int>(num_bytes_in_N - 1);
+
+			const boost::optional<mpz_int> signature = key.sign(message);
+			check(signature != boost::none, name + ": sign");
+			if (signature == boost::none)
+				continue;
+			check(cryptb::gmp_rsa::is_valid_signature(message, signature.get(), key.get_e(), key.get_N()), name + ": the signature verifies");
+			check(!cryptb::gmp_rsa::is_valid_signature(message + 1, signature.get(), key.get_e(), key.get_N()), name + ": the signature doesn't verify another hash");
+			const boost::optional<cpp_int> cpp_int_signature = cpp_int_key.sign(to_cpp_int(message));
+			check(cpp_int_signature != boost::none && cpp_int_signature.get() == to_cpp_int(signature.get()), name + ": the same signature as cpp_int");
+
+			const boost::optional<mpz_int> encrypted = cryptb::gmp_rsa::encrypt(message, key.get_e(), key.get_N());
+			check(encrypted != boost::none, name + ": encrypt");
+			if (encrypted == boost::none)
+				continue;
+			const boost::optional<mpz_int> decrypted = key.decrypt(encrypted.get());
+			check(decrypted != boost::none && decrypted.get() == message, name + ": decrypt gives back the message");
+		}
+	}
+}
+
+int main()
+{
+	// A fixed seed so that every run tests the same keys
+	std::array<std::uint8_t, cryptb::random_engine::optimal_seed_size_bytes> seed{};
+	for (std::size_t index = 0; index < seed.size(); ++index)
+	{
+		seed[index] = static_cast<std::uint8_t>(index * 13 + 5);
+	}
+	cryptb::random_engine engine{ seed };
+
+	check_prime(engine);
+	// 2048-bit RSA
+	check_key(engine, 128, 2);
+	// 1536-bit multi-prime RSA
+	check_key(engine, 64, 3);
+
+	if (num_failures != 0)
+		return 1;
+	std::cout << "gmp_rsa passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,121 @@
+#include "rsa.hpp"
+#include "random_engine.hpp"
+#include "sha512.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// With a fixed-width key, sign and is_valid_signature must not touch the heap at all.
+// Every allocation of the program goes through the counting operator new below.
+
+namespace
+{
+	using number_t = cryptb::fixed_uint<2048>;
+
+	std::atomic<std::uint64_t> num_allocations{ 0 };
+
+	void* counted_allocate(const std::size_t size)
+	{
+		num_allocations.fetch_add(1, std::memory_order_relaxed);
+		if (void* const memory = std::malloc(size == 0 ? 1 : size))
+			return memory;
+		throw std::bad_alloc();
+	}
+}
+
+void* operator new(const std::size_t size)
+{
+	return counted_allocate(size);
+}
+
+void* operator new[](const std::size_t size)
+{
+	return counted_allocate(size);
+}
+
+void operator delete(void* const memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* const memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* const memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* const memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+int main()
+{
+	constexpr int num_hashes = 16;
+	constexpr int num_rounds = 4;
+
+	// A fixed seed so that every run tests the same key
+	std::array<std::uint8_t, cryptb::random_engine::optimal_seed_size_bytes> seed{};
+	for (std::size_t index = 0; index < seed.size(); ++index)
+	{
+		seed[index] = static_cast<std::uint8_t>(index * 7 + 1);
+	}
+	cryptb::random_engine engine{ seed };
+	const cryptb::rsa2048 key{ engine };
+
+	std::vector<number_t> hashes;
+	hashes.reserve(num_hashes);
+	for (int index = 0; index < num_hashes; ++index)
+	{
+		const std::string message = "message " + std::to_string(index);
+		hashes.push_back(cryptb::rsa2048::digest_to_number(
+			cryptb::sha512(reinterpret_cast<const std::uint8_t*>(message.data()), message.size()).digest()));
+	}
+
+	// Warm-up: anything that's set up lazily (like the SHA-512 dispatch) is set up here.
+	for (const number_t& hash : hashes)
+	{
+		const boost::optional<number_t> signature = key.sign(hash);
+		if (signature == boost::none || !cryptb::rsa2048::is_valid_signature(hash, signature.get(), key.get_e(), key.get_N()))
+		{
+			std::cerr << "Signing failed during the warm-up" << std::endl;
+			return 1;
+		}
+	}
+
+	const std::uint64_t num_allocations_before = num_allocations.load(std::memory_order_relaxed);
+	bool all_valid = true;
+	for (int round = 0; round < num_rounds; ++round)
+	{
+		for (const number_t& hash : hashes)
+		{
+			const boost::optional<number_t> signature = key.sign(hash);
+			all_valid = all_valid && signature != boost::none
+				&& cryptb::rsa2048::is_valid_signature(hash, signature.get(), key.get_e(), key.get_N());
+		}
+	}
+	const std::uint64_t num_allocations_during = num_allocations.load(std::memory_order_relaxed) - num_allocations_before;
+
+	if (!all_valid)
+	{
+		std::cerr << "A signature didn't verify" << std::endl;
+		return 1;
+	}
+	if (num_allocations_during != 0)
+	{
+		std::cerr << num_allocations_during << " heap allocations in " << num_rounds * num_hashes
+			<< " rsa2048 sign / is_valid_signature calls, expected none" << std::endl;
+		return 1;
+	}
+	std::cout << "No heap allocations in " << num_rounds * num_hashes << " rsa2048 sign / is_valid_signature calls" << std::endl;
+	return 0;
+}
@@ -0,0 +1,259 @@
+#include "sha512.hpp"
+#include "sha512_multi.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Every compression implementation that the CPU supports must give the same digests as the scalar one:
+// on the FIPS 180-4 test vectors and on random messages of every length from 0 to 2000 bytes,
+// hashed from unaligned addresses and with the input split over several update calls.
+// The same goes for the lanes of sha512_multi, on batches that don't fill the last group of lanes.
+
+namespace
+{
+	using implementation = cryptb::sha512::compress_implementation;
+
+	constexpr std::array<implementation, 2> all_implementations{ { implementation::scalar, implementation::avx2 } };
+
+	constexpr std::size_t max_message_size = 2000;
+
+	using multi_implementation = cryptb::sha512_multi::implementation;
+
+	constexpr std::array<multi_implementation, 3> all_multi_implementations{ {
+		multi_implementation::scalar, multi_implementation::avx2, multi_implementation::avx512 } };
+
+	// Around the padding boundaries: 111 is the longest message that still fits in one block with its length,
+	// 112 needs a second block for it, 128 is exactly one block.
+	constexpr std::array<std::size_t, 6> boundary_message_sizes{ { 0, 111, 112, 127, 128, 129 } };
+
+	// Most of them aren't a multiple of 4 or 8, so some lanes are left empty at the end
+	constexpr std::array<std::size_t, 9> batch_sizes{ { 1, 3, 5, 7, 8, 9, 13, 16, 37 } };
+
+	const char* get_name(const multi_implementation tested)
+	{
+		switch (tested)
+		{
+		case multi_implementation::scalar:
+			return "sha512_multi scalar";
+		case multi_implementation::avx2:
+			return "sha512_multi avx2";
+		case multi_implementation::avx512:
+			return "sha512_multi avx512";
+		default:
+			return "sha512_multi unknown";
+		}
+	}
+
+	const char* get_name(const implementation tested)
+	{
+		switch (tested)
+		{
+		case implementation::scalar:
+			return "scalar";
+		case implementation::avx2:
+			return "avx2";
+		default:
+			return "unknown";
+		}
+	}
+
+	std::string to_hex(const cryptb::sha512::digest_t& digest)
+	{
+		std::string result;
+		for (const std::uint8_t byte : digest)
+		{
+			char digits[3];
+			std::snprintf(digits, sizeof(digits), "%02x", byte);
+			result += digits;
+		}
+		return result;
+	}
+
+	struct test_vector
+	{
+		std::string message;
+		std::string expected_hex;
+	};
+
+	// FIPS 180-4 examples (one block, the empty message and two blocks)
+	const std::array<test_vector, 3> test_vectors{ {
+		{ "abc",
+			"ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f" },
+		{ "",
+			"cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e" },
+		{ "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+			"8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909" } } };
+
+	// One random message and the ways it's fed to sha512
+	struct test_message
+	{
+		std::size_t size = 0;
+		// Where the message starts in "buffer", so that most of them are unaligned
+		std::size_t offset = 0;
+		// update is called on [0, first_split), [first_split, second_split) and [second_split, size)
+		std::size_t first_split = 0;
+		std::size_t second_split = 0;
+	};
+
+	// sha512::update doesn't accept empty input, the pieces of 0 bytes are just skipped.
+	void update(cryptb::sha512& hash, const std::uint8_t* const data, const std::size_t len)
+	{
+		if (len != 0)
+			hash.update(data, len);
+	}
+
+	cryptb::sha512::digest_t hash_in_one_call(const std::uint8_t* const data, const std::size_t len)
+	{
+		cryptb::sha512 hash;
+		update(hash, data, len);
+		return hash.digest();
+	}
+
+	cryptb::sha512::digest_t hash_in_one_call(const std::vector<std::uint8_t>& buffer, const test_message& message)
+	{
+		return hash_in_one_call(buffer.data() + message.offset, message.size);
+	}
+
+	cryptb::sha512::digest_t hash_in_three_calls(const std::vector<std::uint8_t>& buffer, const test_message& message)
+	{
+		const std::uint8_t* const data = buffer.data() + message.offset;
+		cryptb::sha512 hash;
+		update(hash, data, message.first_split);
+		update(hash, data + message.first_split, message.second_split - message.first_split);
+		update(hash, data + message.second_split, message.size - message.second_split);
+		return hash.digest();
+	}
+
+	// Every supported sha512_multi implementation against sha512 one message at a time
+	// (which is what its scalar implementation does). Returns the number of mismatches.
+	int check_multi_implementations(const std::vector<std::uint8_t>& buffer, std::mt19937_64& engine)
+	{
+		std::vector<std::vector<cryptb::sha512_multi::message>> batches;
+		for (const std::size_t batch_size : batch_sizes)
+		{
+			std::vector<cryptb::sha512_multi::message> batch;
+			for (std::size_t index = 0; index < batch_size; ++index)
+			{
+				// The boundary sizes at the start of every batch, random sizes (up to 8 blocks) after them
+				const std::size_t size = index < boundary_message_sizes.size()
+					? boundary_message_sizes[index]
+					: static_cast<std::size_t>(engine() % 1024);
+				const std::size_t offset = static_cast<std::size_t>(engine() % 16);
+				batch.push_back(cryptb::sha512_multi::message{ size == 0 ? nullptr : buffer.data() + offset, size });
+			}
+			batches.push_back(std::move(batch));
+		}
+
+		std::vector<std::vector<cryptb::sha512::digest_t>> expected;
+		for (const std::vector<cryptb::sha512_multi::message>& batch : batches)
+		{
+			std::vector<cryptb::sha512::digest_t> digests;
+			for (const cryptb::sha512_multi::message& msg : batch)
+			{
+				digests.push_back(hash_in_one_call(msg.data, msg.len));
+			}
+			expected.push_back(std::move(digests));
+		}
+
+		int num_failures = 0;
+		for (const multi_implementation tested : all_multi_implementations)
+		{
+			if (!cryptb::sha512_multi::is_supported(tested))
+			{
+				std::cout << get_name(tested) << ": not supported by this CPU, skipped" << std::endl;
+				continue;
+			}
+			int num_implementation_failures = 0;
+			for (std::size_t batch_index = 0; batch_index < batches.size(); ++batch_index)
+			{
+				const std::vector<cryptb::sha512_multi::message>& batch = batches[batch_index];
+				std::vector<cryptb::sha512::digest_t> digests(batch.size());
+				cryptb::sha512_multi::digest(batch, digests, tested);
+				for (std::size_t index = 0; index < batch.size(); ++index)
+				{
+					if (digests[index] != expected[batch_index][index])
+					{
+						std::cerr << get_name(tested) << ": digest differs from sha512 for message " << index
+							<< " (" << batch[index].len << " bytes) of a batch of " << batch.size() << std::endl;
+						++num_implementation_failures;
+					}
+				}
+			}
+			std::cout << get_name(tested) << ": " << (num_implementation_failures == 0 ? "passed" : "FAILED") << std::endl;
+			num_failures += num_implementation_failures;
+		}
+		return num_failures;
+	}
+}
+
+int main()
+{
+	// A fixed seed so that every run tests the same messages
+	std::mt19937_64 engine{ 0x5a512ULL };
+	std::vector<std::uint8_t> buffer(max_message_size + 16);
+	for (std::uint8_t& byte : buffer)
+	{
+		byte = static_cast<std::uint8_t>(engine());
+	}
+	std::vector<test_message> messages;
+	for (std::size_t size = 0; size <= max_message_size; ++size)
+	{
+		test_message message;
+		message.size = size;
+		message.offset = static_cast<std::size_t>(engine() % 16);
+		message.first_split = size == 0 ? 0 : static_cast<std::size_t>(engine() % (size + 1));
+		message.second_split = message.first_split + static_cast<std::size_t>(engine() % (size - message.first_split + 1));
+		messages.push_back(message);
+	}
+
+	// The expected digests come from the scalar implementation
+	cryptb::sha512::set_compress_implementation(implementation::scalar);
+	std::vector<cryptb::sha512::digest_t> expected;
+	expected.reserve(messages.size());
+	for (const test_message& message : messages)
+	{
+		expected.push_back(hash_in_one_call(buffer, message));
+	}
+
+	int num_failures = 0;
+	for (const implementation tested : all_implementations)
+	{
+		if (!cryptb::sha512::is_supported(tested))
+		{
+			std::cout << get_name(tested) << ": not supported by this CPU, skipped" << std::endl;
+			continue;
+		}
+		cryptb::sha512::set_compress_implementation(tested);
+		int num_implementation_failures = 0;
+		for (const test_vector& vector : test_vectors)
+		{
+			const std::string actual_hex = to_hex(hash_in_one_call(
+				reinterpret_cast<const std::uint8_t*>(vector.message.data()), vector.message.size()));
+			if (actual_hex != vector.expected_hex)
+			{
+				std::cerr << get_name(tested) << ": wrong digest of \"" << vector.message << "\": " << actual_hex << std::endl;
+				++num_implementation_failures;
+			}
+		}
+		for (std::size_t index = 0; index < messages.size(); ++index)
+		{
+			const test_message& message = messages[index];
+			if (hash_in_one_call(buffer, message) != expected[index]
+				|| hash_in_three_calls(buffer, message) != expected[index])
+			{
+				std::cerr << get_name(tested) << ": digest differs from scalar for a message of " << message.size
+					<< " bytes at offset " << message.offset << std::endl;
+				++num_implementation_failures;
+			}
+		}
+		std::cout << get_name(tested) << ": " << (num_implementation_failures == 0 ? "passed" : "FAILED") << std::endl;
+		num_failures += num_implementation_failures;
+	}
+	num_failures += check_multi_implementations(buffer, engine);
+	return num_failures == 0 ? 0 : 1;
+}
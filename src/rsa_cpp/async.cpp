@@ -0,0 +1,42 @@
+#include "async.hpp"
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+	std::mutex default_pool_mutex;
+	// Leaked on purpose: tasks that are still running at exit must not find their pool destroyed.
+	cryptb::thread_pool* default_pool_instance = nullptr;
+	int default_pool_num_threads = 0;
+}
+
+cryptb::thread_pool& cryptb::async::default_pool()
+{
+	const std::lock_guard<std::mutex> lock{ default_pool_mutex };
+	if (default_pool_instance == nullptr)
+		default_pool_instance = new thread_pool(default_pool_num_threads);
+	return *default_pool_instance;
+}
+
+void cryptb::async::configure_default_pool(const int num_threads)
+{
+	if (num_threads < 0)
+		throw std::invalid_argument("Error in function \"cryptb::async::configure_default_pool\"."
+			" The argument \"num_threads\" can\'t be negative.");
+	const std::lock_guard<std::mutex> lock{ default_pool_mutex };
+	if (default_pool_instance != nullptr)
+		throw std::logic_error("Error in function \"cryptb::async::configure_default_pool\"."
+			" The default pool was already created, configure it before its first use.");
+	default_pool_num_threads = num_threads;
+}
+
+std::future<cryptb::sha512::digest_t> cryptb::async::hash_file(const std::filesystem::path& path, const cancellation_token& token, thread_pool& pool)
+{
+	return detail::run<sha512::digest_t>(pool, token, [path, token]() -> sha512::digest_t
+	{
+		boost::optional<sha512::digest_t> digest = sha512::hash_file(path, token.get_flag());
+		if (digest == boost::none)
+			throw operation_cancelled();
+		return digest.get();
+	});
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "rsa.hpp"
+#include "sha512.hpp"
+#include "random_engine.hpp"
+#include "thread_pool.hpp"
+#include "cancellation.hpp"
+#include <boost/optional.hpp>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <utility>
+
+// Asynchronous versions of the expensive operations: key generation, decrypt / sign and file hashing.
+//
+// Every function here only queues the work on a thread_pool and returns a std::future right away,
+// so it's safe to call from an event loop or an I/O thread. Don't call get() / wait() on the future
+// from such a thread though, that blocks just like calling the synchronous function would.
+//
+// The future gets the result, or the exception that the operation threw, or operation_cancelled
+// when "token" was cancelled before the operation finished (see cancellation_token for how quickly
+// each operation notices). Arguments are copied into the task, except for the ones that are
+// documented otherwise.
+
+namespace cryptb::async
+{
+	// The pool that the functions here use when no pool is given. Created on first use
+	// with the number of threads given to configure_default_pool
+	// (std::thread::hardware_concurrency() threads if it was never called).
+	// Lives until the end of the program.
+	thread_pool& default_pool();
+
+	// Sets the number of threads of default_pool ("num_threads" == 0 uses std::thread::hardware_concurrency()).
+	// Must be called before the first use of default_pool, throws std::logic_error otherwise.
+	void configure_default_pool(const int num_threads);
+
+	namespace detail
+	{
+		// Runs "operation" on "pool" and hands its result (or exception) to the returned future.
+		// "operation" doesn't run at all if "token" was cancelled while it was waiting in the queue.
+		template <typename result_T, typename operation_T>
+		std::future<result_T> run(thread_pool& pool, const cancellation_token& token, operation_T&& operation)
+		{
+			// std::function (thread_pool::task_t) needs a copyable task, std::promise isn't.
+			auto promise = std::make_shared<std::promise<result_T>>();
+			std::future<result_T> result = promise->get_future();
+			pool.submit([promise, token, operation = std::forward<operation_T>(operation)]() mutable -> void
+			{
+				try
+				{
+					if (token.is_cancelled())
+						throw operation_cancelled();
+					promise->set_value(operation());
+				}
+				catch (...)
+				{
+					promise->set_exception(std::current_exception());
+				}
+			});
+			return result;
+		}
+	}
+
+	// basic_rsa(rand, "num_bytes_in_prime_number", 1, "num_primes") on one thread of "pool".
+	// "token" stops the prime searches between two candidates.
+	//
+	// "rand" is only used on the calling thread (to fork the engine of the task),
+	// so the same engine can be passed to many calls in a row.
+	template <typename int_T = boost::multiprecision::cpp_int>
+	std::future<basic_rsa<int_T>> generate_key(random_engine& rand, const int num_bytes_in_prime_number = 128, const int num_primes = 2,
+		const cancellation_token& token = cancellation_token(), thread_pool& pool = default_pool())
+	{
+		return detail::run<basic_rsa<int_T>>(pool, token,
+			[engine = rand.fork(), num_bytes_in_prime_number, num_primes, token]() mutable -> basic_rsa<int_T>
+			{
+				return basic_rsa<int_T>(engine, num_bytes_in_prime_number, 1, num_primes, nullptr, &token.get_flag());
+			});
+	}
+
+	// "key".sign("message_hash") on "pool".
+	// "key" isn't copied: it must stay alive (and unchanged) until the future is ready.
+	template <typename int_T>
+	std::future<boost::optional<int_T>> sign(const basic_rsa<int_T>& key, const int_T& message_hash,
+		const cancellation_token& token = cancellation_token(), thread_pool& pool = default_pool())
+	{
+		return detail::run<boost::optional<int_T>>(pool, token,
+			[&key, message_hash]() -> boost::optional<int_T>
+			{
+				return key.sign(message_hash);
+			});
+	}
+
+	// "key".decrypt("encrypted_message") on "pool".
+	// "key" isn't copied: it must stay alive (and unchanged) until the future is ready.
+	template <typename int_T>
+	std::future<boost::optional<int_T>> decrypt(const basic_rsa<int_T>& key, const int_T& encrypted_message,
+		const cancellation_token& token = cancellation_token(), thread_pool& pool = default_pool())
+	{
+		return detail::run<boost::optional<int_T>>(pool, token,
+			[&key, encrypted_message]() -> boost::optional<int_T>
+			{
+				return key.decrypt(encrypted_message);
+			});
+	}
+
+	// sha512::hash_file("path") on "pool". "token" is checked after every 1 MiB of the file.
+	std::future<sha512::digest_t> hash_file(const std::filesystem::path& path,
+		const cancellation_token& token = cancellation_token(), thread_pool& pool = default_pool());
+}
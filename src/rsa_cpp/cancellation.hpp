@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace cryptb
+{
+	// Thrown by the operations that were cancelled (see cancellation_token).
+	class operation_cancelled : public std::runtime_error
+	{
+	public:
+		operation_cancelled() : std::runtime_error("The operation was cancelled.") {}
+	};
+
+	// Lets one thread ask the operations that another thread is running (or hasn't started yet) to stop.
+	// Copies share the same state: cancelling any copy cancels all of them.
+	//
+	// Long operations check the token while they run (the prime searches of key generation
+	// after every candidate, file hashing after every 1 MiB), short ones only before they start.
+	class cancellation_token
+	{
+		std::shared_ptr<std::atomic<bool>> m_cancelled = std::make_shared<std::atomic<bool>>(false);
+
+	public:
+		void cancel()
+		{
+			this->m_cancelled->store(true, std::memory_order_relaxed);
+		}
+
+		bool is_cancelled() const
+		{
+			return this->m_cancelled->load(std::memory_order_relaxed);
+		}
+
+		// For the functions that take a "stop_requested" flag (like prime::gen_random).
+		// Stays valid as long as any copy of the token is alive.
+		const std::atomic<bool>& get_flag() const
+		{
+			return *this->m_cancelled;
+		}
+	};
+}
@@ -0,0 +1,151 @@
+#include "concurrent_random_engine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <boost/endian/conversion.hpp>
+
+namespace
+{
+	std::atomic<std::uint64_t> next_engine_id{ 0 };
+
+	// The concurrent_random_engines that are alive right now
+	struct live_engines
+	{
+		std::mutex mutex;
+		std::unordered_set<std::uint64_t> ids;
+	};
+
+	// Never destroyed: engines with static storage duration (in any translation unit)
+	// can be constructed before and destroyed after any static object of this one.
+	live_engines& get_live_engines()
+	{
+		static live_engines* const instance = new live_engines;
+		return *instance;
+	}
+	// Bumped by every destructor. A thread that sees a new value may be holding shards of dead engines.
+	std::atomic<std::uint64_t> num_engines_destroyed{ 0 };
+
+	struct shard
+	{
+		std::uint64_t engine_id;
+		cryptb::random_engine engine;
+	};
+
+	// Overwrites the secret state before the memory goes back to the allocator.
+	void wipe(shard& dead)
+	{
+		dead.engine = cryptb::random_engine{ std::array<std::uint8_t, cryptb::random_engine::optimal_seed_size_bytes>{} };
+	}
+
+	struct thread_shards
+	{
+		// Behind pointers so that the references handed out by local_shard
+		// stay valid when other shards are added or erased.
+		std::vector<std::unique_ptr<shard>> shards;
+		// num_engines_destroyed when this thread last erased the shards of dead engines
+		std::uint64_t num_engines_destroyed_seen = 0;
+
+		// The thread is exiting
+		~thread_shards()
+		{
+			for (const std::unique_ptr<shard>& existing : this->shards)
+			{
+				wipe(*existing);
+			}
+		}
+	};
+
+	// Usually there's only one concurrent_random_engine in the program, so a linear search is fine.
+	thread_local thread_shards local_shards;
+
+	void erase_dead_shards(thread_shards& local)
+	{
+		const std::uint64_t num_destroyed = num_engines_destroyed.load(std::memory_order_acquire);
+		if (num_destroyed == local.num_engines_destroyed_seen)
+			return;
+		{
+			live_engines& live = get_live_engines();
+			const std::lock_guard<std::mutex> lock{ live.mutex };
+			std::erase_if(local.shards, [&live](const std::unique_ptr<shard>& existing) -> bool
+			{
+				if (live.ids.contains(existing->engine_id))
+					return false;
+				wipe(*existing);
+				return true;
+			});
+		}
+		local.num_engines_destroyed_seen = num_destroyed;
+	}
+}
+
+cryptb::concurrent_random_engine::concurrent_random_engine()
+	: concurrent_random_engine(random_engine{})
+{
+}
+
+cryptb::concurrent_random_engine::concurrent_random_engine(random_engine root)
+	: m_root(std::move(root)), m_id(next_engine_id.fetch_add(1, std::memory_order_relaxed))
+{
+	live_engines& live = get_live_engines();
+	const std::lock_guard<std::mutex> lock{ live.mutex };
+	live.ids.insert(this->m_id);
+}
+
+cryptb::concurrent_random_engine::~concurrent_random_engine()
+{
+	{
+		live_engines& live = get_live_engines();
+		const std::lock_guard<std::mutex> lock{ live.mutex };
+		live.ids.erase(this->m_id);
+	}
+	num_engines_destroyed.fetch_add(1, std::memory_order_release);
+	// The destroying thread's own shard goes right away.
+	erase_dead_shards(local_shards);
+}
+
+cryptb::random_engine& cryptb::concurrent_random_engine::local_shard()
+{
+	// Just one atomic load when no engine was destroyed since the last call
+	erase_dead_shards(local_shards);
+	for (const std::unique_ptr<shard>& existing : local_shards.shards)
+	{
+		if (existing->engine_id == this->m_id)
+			return existing->engine;
+	}
+	// The seed is 1024 bits from the root, then a label and the shard's number.
+	static constexpr char shard_label[] = "cryptb::concurrent_random_engine shard";
+	std::array<std::uint8_t, random_engine::optimal_seed_size_bytes> seed_bytes{ {0} };
+	static_assert(2 * 64 + sizeof(shard_label) + 8 <= random_engine::optimal_seed_size_bytes, "Everything fits in the seed");
+	{
+		const std::lock_guard<std::mutex> lock{ this->m_root_mutex };
+		const std::array<std::uint8_t, 64> first = this->m_root.gen_512_bit_random_number();
+		const std::array<std::uint8_t, 64> second = this->m_root.gen_512_bit_random_number();
+		std::copy(first.cbegin(), first.cend(), seed_bytes.begin());
+		std::copy(second.cbegin(), second.cend(), seed_bytes.begin() + first.size());
+		boost::endian::store_big_u64(seed_bytes.data() + 2 * 64 + sizeof(shard_label), this->m_num_shards);
+		++this->m_num_shards;
+	}
+	std::copy(std::cbegin(shard_label), std::cend(shard_label), seed_bytes.begin() + 2 * 64);
+	local_shards.shards.push_back(std::make_unique<shard>(shard{ this->m_id, random_engine{ seed_bytes } }));
+	return local_shards.shards.back()->engine;
+}
+
+std::array<std::uint8_t, 64> cryptb::concurrent_random_engine::gen_512_bit_random_number()
+{
+	return this->local_shard().gen_512_bit_random_number();
+}
+
+void cryptb::concurrent_random_engine::fill(std::span<std::uint8_t> output)
+{
+	this->local_shard().fill(output);
+}
+
+std::uint64_t cryptb::concurrent_random_engine::get_num_shards()
+{
+	const std::lock_guard<std::mutex> lock{ this->m_root_mutex };
+	return this->m_num_shards;
+}
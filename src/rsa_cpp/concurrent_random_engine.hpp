@@ -0,0 +1,72 @@
+#pragma once
+
+#include "random_engine.hpp"
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cstdint>
+#include <mutex>
+#include <span>
+
+namespace cryptb
+{
+	// A random_engine that any number of threads can use at the same time.
+	//
+	// Every thread gets its own shard: a random_engine that's seeded once from the root engine
+	// the first time that thread uses this object. After that the thread only ever touches
+	// its own shard, so generating doesn't take any lock.
+	//
+	// The seed of every shard has the shard's number in it next to the root's output,
+	// so no two shards can ever end up with the same state (domain separation).
+	//
+	// Which thread gets which shard depends on the order that the threads arrive in,
+	// so the output isn't reproducible from the root's seed the way random_engine's is.
+	// Use random_engine::fork per thread when reproducibility matters.
+	//
+	// Destroying this object overwrites and frees its shards, each thread's one the next time
+	// that thread uses any concurrent_random_engine (or when the thread exits).
+	class concurrent_random_engine
+	{
+		std::mutex m_root_mutex;
+		random_engine m_root;
+		std::uint64_t m_num_shards = 0;
+		// Unique for every object ever constructed, the shards are looked up by it.
+		// (The address could be reused by another object after this one is destroyed.)
+		const std::uint64_t m_id;
+
+		// The calling thread's shard, seeded from m_root on first use.
+		random_engine& local_shard();
+
+	public:
+		// Truly random root
+		concurrent_random_engine();
+		explicit concurrent_random_engine(random_engine root);
+		concurrent_random_engine(const concurrent_random_engine&) = delete;
+		concurrent_random_engine& operator=(const concurrent_random_engine&) = delete;
+		~concurrent_random_engine();
+
+		// The same as the random_engine functions, on the calling thread's shard.
+		template <typename int_T = boost::multiprecision::cpp_int>
+		int_T operator()(int num_bytes)
+		{
+			return this->local_shard().operator()<int_T>(num_bytes);
+		}
+		std::array<std::uint8_t, 64> gen_512_bit_random_number();
+		void fill(std::span<std::uint8_t> output);
+
+		template <unsigned MinBits, unsigned MaxBits, boost::multiprecision::cpp_integer_type SignType, boost::multiprecision::cpp_int_check_type Checked, class Allocator>
+		void generate_into(boost::multiprecision::number<boost::multiprecision::cpp_int_backend<MinBits, MaxBits, SignType, Checked, Allocator>>& result, const unsigned num_bits)
+		{
+			this->local_shard().generate_into(result, num_bits);
+		}
+
+		// The calling thread's shard itself, for code that takes a random_engine&
+		// (like the basic_rsa constructor). Only use it on the calling thread.
+		// Stays valid until this object is destroyed (other concurrent_random_engines come and go freely).
+		random_engine& get_local_engine()
+		{
+			return this->local_shard();
+		}
+
+		// How many threads have used this object so far
+		std::uint64_t get_num_shards();
+	};
+}
@@ -0,0 +1,93 @@
+#include "cpu_features.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace
+{
+	struct cpuid_registers
+	{
+		unsigned int eax = 0;
+		unsigned int ebx = 0;
+		unsigned int ecx = 0;
+		unsigned int edx = 0;
+	};
+
+	cpuid_registers cpuid(const unsigned int leaf, const unsigned int subleaf)
+	{
+		cpuid_registers result;
+#if defined(_MSC_VER) && !defined(__clang__)
+		int registers[4]{};
+		__cpuidex(registers, static_cast<int>(leaf), static_cast<int>(subleaf));
+		result.eax = static_cast<unsigned int>(registers[0]);
+		result.ebx = static_cast<unsigned int>(registers[1]);
+		result.ecx = static_cast<unsigned int>(registers[2]);
+		result.edx = static_cast<unsigned int>(registers[3]);
+#else
+		__cpuid_count(leaf, subleaf, result.eax, result.ebx, result.ecx, result.edx);
+#endif
+		return result;
+	}
+
+	// Which register states the operating system saves on context switches
+	unsigned long long enabled_register_state()
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		return _xgetbv(0);
+#else
+		unsigned int low = 0, high = 0;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return (static_cast<unsigned long long>(high) << 32) | low;
+#endif
+	}
+
+	bool has_bits(const unsigned long long value, const unsigned long long bits)
+	{
+		return (value & bits) == bits;
+	}
+
+	cryptb::cpu_features detect()
+	{
+		cryptb::cpu_features features;
+		if (cpuid(0, 0).eax < 7)
+			return features;
+		const cpuid_registers leaf1 = cpuid(1, 0);
+		const cpuid_registers leaf7 = cpuid(7, 0);
+		features.bmi1 = has_bits(leaf7.ebx, 1U << 3);
+		features.bmi2 = has_bits(leaf7.ebx, 1U << 8);
+
+		// OSXSAVE, otherwise XGETBV doesn't even exist
+		if (!has_bits(leaf1.ecx, 1U << 27))
+			return features;
+		const unsigned long long state = enabled_register_state();
+		// XMM and YMM
+		const bool ymm_enabled = has_bits(state, 0x6);
+		// And the mask registers, the upper halves of ZMM0-15 and ZMM16-31
+		const bool zmm_enabled = has_bits(state, 0xE6);
+		const bool avx = has_bits(leaf1.ecx, 1U << 28);
+		features.avx2 = ymm_enabled && avx && has_bits(leaf7.ebx, 1U << 5);
+		features.avx512f = zmm_enabled && avx && has_bits(leaf7.ebx, 1U << 16);
+		return features;
+	}
+}
+
+const cryptb::cpu_features& cryptb::cpu_features::get()
+{
+	static const cpu_features features = detect();
+	return features;
+}
+
+#else
+
+const cryptb::cpu_features& cryptb::cpu_features::get()
+{
+	static const cpu_features features;
+	return features;
+}
+
+#endif
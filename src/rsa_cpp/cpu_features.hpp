@@ -0,0 +1,20 @@
+#pragma once
+
+namespace cryptb
+{
+	// The instruction set extensions that the optimized code paths need.
+	// Each flag is only true if both the CPU has the instructions and the operating system
+	// saves the registers that they use (checked with XGETBV), so it's safe to use them.
+	// Everything is false when not compiling for x86-64.
+	struct cpu_features
+	{
+		bool bmi1 = false;
+		bool bmi2 = false;
+		bool avx2 = false;
+		// Only the foundation instructions (512-bit registers, mask registers, vprorq, vpternlogq)
+		bool avx512f = false;
+
+		// Detected with CPUID the first time this is called.
+		static const cpu_features& get();
+	};
+}
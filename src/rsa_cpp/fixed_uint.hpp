@@ -0,0 +1,13 @@
+#pragma once
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+namespace cryptb
+{
+	// Fixed-width unsigned integer with exactly "Bits" bits.
+	// Lives entirely on the stack (no heap allocation) and skips the limb-count checks
+	// that the arbitrary precision boost::multiprecision::cpp_int has to do.
+	template <unsigned Bits>
+	using fixed_uint = boost::multiprecision::number<boost::multiprecision::cpp_int_backend<
+		Bits, Bits, boost::multiprecision::unsigned_magnitude, boost::multiprecision::unchecked, void>>;
+}
@@ -0,0 +1,75 @@
+#include "hmac_sha512.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace
+{
+	constexpr std::size_t block_size = 128;
+	constexpr std::uint8_t ipad = 0x36;
+	constexpr std::uint8_t opad = 0x5c;
+
+	cryptb::sha512 start_with_padded_key(const std::array<std::uint8_t, block_size>& key_block, const std::uint8_t pad)
+	{
+		std::array<std::uint8_t, block_size> padded_key{ {0} };
+		for (std::size_t index = 0; index < block_size; ++index)
+		{
+			padded_key[index] = key_block[index] ^ pad;
+		}
+		// Through the midstate, so that the block is already compressed
+		// (sha512 only compresses a full block on the next "update").
+		return cryptb::sha512{ cryptb::sha512{ padded_key.data(), padded_key.size() }.export_midstate().get() };
+	}
+}
+
+cryptb::hmac_sha512::hmac_sha512(const std::uint8_t* const key, const std::size_t key_len)
+{
+	if (key == nullptr && key_len != 0)
+	{
+		throw std::invalid_argument("Error in function \"hmac_sha512::hmac_sha512\"."
+			" \"key\" can\'t be nullptr when \"key_len\" isn\'t 0.");
+	}
+	std::array<std::uint8_t, block_size> key_block{ {0} };
+	if (key_len > block_size)
+	{
+		const sha512::digest_t hashed_key = sha512{ key, key_len }.digest();
+		std::copy(hashed_key.cbegin(), hashed_key.cend(), key_block.begin());
+	}
+	else if (key_len != 0)
+	{
+		std::copy(key, key + key_len, key_block.begin());
+	}
+	this->m_inner = start_with_padded_key(key_block, ipad);
+	this->m_outer = start_with_padded_key(key_block, opad);
+}
+
+cryptb::hmac_sha512::hmac_sha512(const midstate_t& inner_midstate, const midstate_t& outer_midstate)
+	: m_inner(inner_midstate), m_outer(outer_midstate)
+{
+}
+
+cryptb::sha512::digest_t cryptb::hmac_sha512::digest(const std::uint8_t* const data, const std::size_t len) const
+{
+	if (data == nullptr && len != 0)
+	{
+		throw std::invalid_argument("Error in function \"hmac_sha512::digest\"."
+			" \"data\" can\'t be nullptr when \"len\" isn\'t 0.");
+	}
+	sha512 inner = this->m_inner;
+	if (len != 0)
+		inner.update(data, len);
+	const sha512::digest_t inner_digest = inner.digest();
+	sha512 outer = this->m_outer;
+	outer.update(inner_digest.data(), inner_digest.size());
+	return outer.digest();
+}
+
+cryptb::hmac_sha512::midstate_t cryptb::hmac_sha512::get_inner_midstate() const
+{
+	return this->m_inner.export_midstate().get();
+}
+
+cryptb::hmac_sha512::midstate_t cryptb::hmac_sha512::get_outer_midstate() const
+{
+	return this->m_outer.export_midstate().get();
+}
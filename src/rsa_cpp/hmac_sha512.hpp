@@ -0,0 +1,42 @@
+#pragma once
+
+#include "sha512.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace cryptb
+{
+	// HMAC-SHA-512 (RFC 2104, RFC 4231).
+	//
+	// HMAC(key, message) = SHA-512((key ^ opad) || SHA-512((key ^ ipad) || message))
+	// where (key ^ ipad) and (key ^ opad) are each exactly one message block.
+	// The constructor hashes those two blocks once and keeps the two midstates,
+	// so every "digest" only hashes the message plus one block for the outer hash,
+	// instead of two extra blocks for the key.
+	//
+	// The midstates can be exported and used to construct the object again without the key
+	// (they're as secret as the key).
+	class hmac_sha512
+	{
+		// Right after the (key ^ ipad) block
+		sha512 m_inner;
+		// Right after the (key ^ opad) block
+		sha512 m_outer;
+
+	public:
+		using midstate_t = sha512::midstate_t;
+
+		// Keys longer than 128 bytes are hashed first, as the standard says.
+		// "key" can be nullptr when "key_len" == 0.
+		hmac_sha512(const std::uint8_t* const key, const std::size_t key_len);
+
+		// From the midstates that "get_inner_midstate" and "get_outer_midstate" returned.
+		hmac_sha512(const midstate_t& inner_midstate, const midstate_t& outer_midstate);
+
+		// "data" can be nullptr when "len" == 0.
+		sha512::digest_t digest(const std::uint8_t* const data, const std::size_t len) const;
+
+		midstate_t get_inner_midstate() const;
+		midstate_t get_outer_midstate() const;
+	};
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+namespace cryptb
+{
+	// What key generation spent its time on. Pass a pointer to one to the basic_rsa constructor
+	// (or to basic_prime::gen_random) to have it filled in, or nullptr (the default) to skip
+	// the bookkeeping altogether: the clock is never read then.
+	//
+	// Everything is added to what's already there, so one object can collect the totals
+	// of many key generations. Not thread-safe: give every thread its own object and add them up
+	// with operator+= (the functions that use several threads already do that internally).
+	struct keygen_stats
+	{
+		// basic_prime::gen_random
+
+		// Random starting points drawn from the engine. There's a new one whenever
+		// the search walks out of an unusually large prime gap (or past the requested size).
+		std::uint64_t num_random_starts = 0;
+		// Candidates looked at, including the ones that the small primes sieved out
+		std::uint64_t num_candidates = 0;
+		// Candidates that made it through the sieve to the primality test (see primality_test)
+		std::uint64_t num_primality_tests = 0;
+		// Strong probable prime tests, the base-2 one included.
+		// Nearly every composite is rejected after 1, a prime takes 1 + get_miller_rabin_rounds.
+		std::uint64_t num_miller_rabin_rounds = 0;
+		// Strong Lucas tests (only with primality_test::baillie_psw)
+		std::uint64_t num_lucas_tests = 0;
+		std::uint64_t num_primes_found = 0;
+
+		// basic_rsa constructor
+
+		std::uint64_t num_keys = 0;
+		// Whole sets of primes that were thrown away because e wasn't coprime with N or PhiN
+		// (or because the product of more than two primes came out a bit short)
+		std::uint64_t num_e_compatibility_retries = 0;
+		// Primes that were thrown away because the key already had the same prime
+		std::uint64_t num_duplicate_primes = 0;
+		// Wall-clock time of each phase
+		std::uint64_t prime_generation_nanoseconds = 0;
+		// d, the CRT components and the Montgomery setup
+		std::uint64_t private_key_nanoseconds = 0;
+		// Encrypting, decrypting and signing with the new key before returning it
+		std::uint64_t self_test_nanoseconds = 0;
+
+		keygen_stats& operator+=(const keygen_stats& other)
+		{
+			this->num_random_starts += other.num_random_starts;
+			this->num_candidates += other.num_candidates;
+			this->num_primality_tests += other.num_primality_tests;
+			this->num_miller_rabin_rounds += other.num_miller_rabin_rounds;
+			this->num_lucas_tests += other.num_lucas_tests;
+			this->num_primes_found += other.num_primes_found;
+			this->num_keys += other.num_keys;
+			this->num_e_compatibility_retries += other.num_e_compatibility_retries;
+			this->num_duplicate_primes += other.num_duplicate_primes;
+			this->prime_generation_nanoseconds += other.prime_generation_nanoseconds;
+			this->private_key_nanoseconds += other.private_key_nanoseconds;
+			this->self_test_nanoseconds += other.self_test_nanoseconds;
+			return *this;
+		}
+	};
+}
@@ -0,0 +1,164 @@
+#include "modinv.hpp"
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+	// The cofactors are signed and the intermediate results of the Lehmer updates
+	// can be up to 62 bits larger than the modulus.
+	// For a fixed_uint the work is done in a signed fixed-width number that is one limb wider,
+	// which keeps everything on the stack. cpp_int is already signed and unbounded.
+	template <typename int_T, bool is_fixed_width = std::numeric_limits<int_T>::is_bounded>
+	struct work_type
+	{
+		using type = boost::multiprecision::cpp_int;
+	};
+
+	template <typename int_T>
+	struct work_type<int_T, true>
+	{
+		static constexpr unsigned bits = std::numeric_limits<int_T>::digits + 64;
+		using type = boost::multiprecision::number<boost::multiprecision::cpp_int_backend<
+			bits, bits, boost::multiprecision::signed_magnitude, boost::multiprecision::unchecked, void>>;
+	};
+
+	// Number of bits in the single precision approximations.
+	// Small enough that (x + A) and (y + D) below can't overflow a std::int64_t.
+	constexpr unsigned lehmer_bits = 62;
+
+	// (num >> shift) for a positive "num" where the result fits in 64 bits,
+	// read straight from the limbs so that no temporary number is created.
+	template <typename num_T>
+	std::uint64_t bits_at(const num_T& num, const unsigned shift)
+	{
+		using limb_type = boost::multiprecision::limb_type;
+		constexpr unsigned limb_bits = std::numeric_limits<limb_type>::digits;
+		const limb_type* const limbs = num.backend().limbs();
+		const unsigned num_limbs = num.backend().size();
+		unsigned limb_index = shift / limb_bits;
+		if (limb_index >= num_limbs)
+			return 0;
+		const unsigned offset = shift % limb_bits;
+		std::uint64_t result = static_cast<std::uint64_t>(limbs[limb_index] >> offset);
+		unsigned filled = limb_bits - offset;
+		for (++limb_index; limb_index < num_limbs && filled < 64; ++limb_index)
+		{
+			result |= static_cast<std::uint64_t>(limbs[limb_index]) << filled;
+			filled += limb_bits;
+		}
+		return result;
+	}
+}
+
+template <typename int_T>
+boost::optional<int_T> cryptb::modinv(const int_T& a, const int_T& modulus)
+{
+	if (modulus < 2 || a < 0)
+	{
+		throw std::invalid_argument("Error in function \"cryptb::modinv\"."
+			" \"modulus\" must be at least 2 and \"a\" can\'t be negative.");
+	}
+	using work_t = typename work_type<int_T>::type;
+	// Invariants (everything is modulo "modulus"):
+	//	x == x_cofactor * a
+	//	y == y_cofactor * a
+	// At the end x is gcd(a, modulus) and if that's 1 then x_cofactor is the inverse.
+	work_t x{ modulus };
+	work_t y{ a };
+	if (y >= x)
+		y %= x;
+	work_t x_cofactor = 0;
+	work_t y_cofactor = 1;
+	// Scratch space for the updates, reused by every step
+	work_t quotient, next_x, next_y, product;
+	while (y != 0)
+	{
+		// Run Euclid's algorithm on the leading bits of x and y (shifted by the same amount).
+		// The matrix [A B; C D] collects the steps, so that the real values are:
+		//	x' = A * x + B * y
+		//	y' = C * x + D * y
+		// A step is only taken when the quotient is certainly the same as the quotient of the real
+		// values, which is when it doesn't depend on the (unknown) lower bits (Knuth's algorithm L).
+		const unsigned x_bits = boost::multiprecision::msb(x) + 1;
+		const unsigned shift = x_bits > lehmer_bits ? x_bits - lehmer_bits : 0;
+		std::int64_t x_high = static_cast<std::int64_t>(bits_at(x, shift));
+		std::int64_t y_high = static_cast<std::int64_t>(bits_at(y, shift));
+		std::int64_t A = 1, B = 0, C = 0, D = 1;
+		while (y_high + C > 0 && y_high + D > 0)
+		{
+			const std::int64_t q = (x_high + A) / (y_high + C);
+			if (q != (x_high + B) / (y_high + D))
+				break;
+			A = std::exchange(C, A - q * C);
+			B = std::exchange(D, B - q * D);
+			x_high = std::exchange(y_high, x_high - q * y_high);
+		}
+		if (B == 0)
+		{
+			// Not even one quotient was certain (a very large quotient), one full precision step.
+			boost::multiprecision::divide_qr(x, y, quotient, next_y);
+			x.swap(y);
+			y.swap(next_y);
+			product = quotient;
+			product *= y_cofactor;
+			x_cofactor -= product;
+			x_cofactor.swap(y_cofactor);
+			continue;
+		}
+		next_x = x;
+		next_x *= A;
+		product = y;
+		product *= B;
+		next_x += product;
+		next_y = x;
+		next_y *= C;
+		product = y;
+		product *= D;
+		next_y += product;
+		x.swap(next_x);
+		y.swap(next_y);
+
+		next_x = x_cofactor;
+		next_x *= A;
+		product = y_cofactor;
+		product *= B;
+		next_x += product;
+		next_y = x_cofactor;
+		next_y *= C;
+		product = y_cofactor;
+		product *= D;
+		next_y += product;
+		x_cofactor.swap(next_x);
+		y_cofactor.swap(next_y);
+	}
+	if (x != 1)
+		return boost::none;
+	// |x_cofactor| <= modulus / 2 so one addition is enough to make it positive.
+	if (x_cofactor < 0)
+		x_cofactor += work_t{ modulus };
+	return static_cast<int_T>(x_cofactor);
+}
+
+template boost::optional<boost::multiprecision::cpp_int> cryptb::modinv(const boost::multiprecision::cpp_int&, const boost::multiprecision::cpp_int&);
+template boost::optional<cryptb::fixed_uint<1024>> cryptb::modinv(const cryptb::fixed_uint<1024>&, const cryptb::fixed_uint<1024>&);
+template boost::optional<cryptb::fixed_uint<2048>> cryptb::modinv(const cryptb::fixed_uint<2048>&, const cryptb::fixed_uint<2048>&);
+template boost::optional<cryptb::fixed_uint<3072>> cryptb::modinv(const cryptb::fixed_uint<3072>&, const cryptb::fixed_uint<3072>&);
+template boost::optional<cryptb::fixed_uint<4096>> cryptb::modinv(const cryptb::fixed_uint<4096>&, const cryptb::fixed_uint<4096>&);
+
+#ifdef CRYPTB_WITH_GMP
+template <>
+boost::optional<boost::multiprecision::mpz_int> cryptb::modinv(const boost::multiprecision::mpz_int& a, const boost::multiprecision::mpz_int& modulus)
+{
+	if (modulus < 2 || a < 0)
+	{
+		throw std::invalid_argument("Error in function \"cryptb::modinv\"."
+			" \"modulus\" must be at least 2 and \"a\" can\'t be negative.");
+	}
+	boost::multiprecision::mpz_int result;
+	if (mpz_invert(result.backend().data(), a.backend().data(), modulus.backend().data()) == 0)
+		return boost::none;
+	return result;
+}
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "fixed_uint.hpp"
+#include "number_traits.hpp"
+#include <boost/optional.hpp>
+
+namespace cryptb
+{
+	// The modular inverse of "a" modulo "modulus":
+	// the x in [0, modulus) such that ((a * x) modulo modulus) == 1
+	//
+	// Returns boost::none when there is no such x (when gcd(a, modulus) != 1).
+	// "a" doesn't have to be smaller than "modulus".
+	// Throws std::invalid_argument if "modulus" < 2 or if "a" is negative.
+	//
+	// Uses Lehmer's variant of the extended Euclidean algorithm:
+	// most quotients are found from the leading 62 bits of the two remainders
+	// with plain 64-bit arithmetic, and the big numbers are only updated
+	// once every ~30 steps instead of being divided at every step.
+	// Only the cofactor of "a" is tracked (it's the only one that's needed).
+	//
+	// Constant memory: nothing depends on the number of steps.
+	// When "int_T" is a fixed_uint there are no heap allocations at all.
+	//
+	// Only the instantiations declared with "extern template" at the bottom of this file
+	// are compiled into the library.
+	template <typename int_T>
+	boost::optional<int_T> modinv(const int_T& a, const int_T& modulus);
+
+	extern template boost::optional<boost::multiprecision::cpp_int> modinv(const boost::multiprecision::cpp_int&, const boost::multiprecision::cpp_int&);
+	extern template boost::optional<fixed_uint<1024>> modinv(const fixed_uint<1024>&, const fixed_uint<1024>&);
+	extern template boost::optional<fixed_uint<2048>> modinv(const fixed_uint<2048>&, const fixed_uint<2048>&);
+	extern template boost::optional<fixed_uint<3072>> modinv(const fixed_uint<3072>&, const fixed_uint<3072>&);
+	extern template boost::optional<fixed_uint<4096>> modinv(const fixed_uint<4096>&, const fixed_uint<4096>&);
+#ifdef CRYPTB_WITH_GMP
+	// GMP has its own (mpz_invert)
+	template <>
+	boost::optional<boost::multiprecision::mpz_int> modinv(const boost::multiprecision::mpz_int& a, const boost::multiprecision::mpz_int& modulus);
+#endif
+}
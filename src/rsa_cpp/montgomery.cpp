@@ -0,0 +1,355 @@
+#include "montgomery.hpp"
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+// (hi, lo) = a * b + c + d
+// Never overflows because (2^64 - 1)^2 + 2 * (2^64 - 1) == 2^128 - 1
+static inline void multiply_add(
+	const std::uint64_t a, const std::uint64_t b, const std::uint64_t c, const std::uint64_t d,
+	std::uint64_t& hi, std::uint64_t& lo)
+{
+#if defined(__SIZEOF_INT128__)
+	const unsigned __int128 product = static_cast<unsigned __int128>(a) * b + c + d;
+	lo = static_cast<std::uint64_t>(product);
+	hi = static_cast<std::uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	std::uint64_t high = 0;
+	std::uint64_t low = _umul128(a, b, &high);
+	low += c;
+	high += low < c;
+	low += d;
+	high += low < d;
+	lo = low;
+	hi = high;
+#else
+	// Portable fallback, 32 bits at a time.
+	const std::uint64_t a_lo = a & 0xffffffffULL, a_hi = a >> 32;
+	const std::uint64_t b_lo = b & 0xffffffffULL, b_hi = b >> 32;
+	const std::uint64_t lo_lo = a_lo * b_lo;
+	const std::uint64_t hi_lo = a_hi * b_lo;
+	const std::uint64_t lo_hi = a_lo * b_hi;
+	const std::uint64_t hi_hi = a_hi * b_hi;
+	const std::uint64_t middle = (lo_lo >> 32) + (hi_lo & 0xffffffffULL) + lo_hi;
+	std::uint64_t low = (middle << 32) | (lo_lo & 0xffffffffULL);
+	std::uint64_t high = hi_hi + (hi_lo >> 32) + (middle >> 32);
+	low += c;
+	high += low < c;
+	low += d;
+	high += low < d;
+	lo = low;
+	hi = high;
+#endif
+}
+
+cryptb::montgomery_kernel::limb_t cryptb::montgomery_kernel::negated_inverse(const limb_t n0)
+{
+	if ((n0 & 1) == 0)
+	{
+		throw std::invalid_argument("Error in function \"cryptb::montgomery_kernel::negated_inverse\"."
+			" An even number has no inverse modulo 2^64.");
+	}
+	// Newton's iteration. n0 is its own inverse modulo 2^3 (true for every odd number)
+	// and every iteration doubles the number of correct bits: 3, 6, 12, 24, 48, 96
+	limb_t inverse = n0;
+	for (int iteration = 0; iteration < 5; ++iteration)
+	{
+		inverse *= 2 - n0 * inverse;
+	}
+	return 0 - inverse;
+}
+
+void cryptb::montgomery_kernel::multiply(
+	limb_t* const result,
+	const limb_t* const a,
+	const limb_t* const b,
+	const limb_t* const modulus,
+	const limb_t modulus_inverse,
+	const int num_limbs,
+	limb_t* const scratch)
+{
+	limb_t* const t = scratch;
+	std::fill(t, t + num_limbs + 2, 0);
+	for (int i = 0; i < num_limbs; ++i)
+	{
+		// t += a * b[i]
+		limb_t carry = 0;
+		for (int j = 0; j < num_limbs; ++j)
+		{
+			multiply_add(a[j], b[i], t[j], carry, carry, t[j]);
+		}
+		t[num_limbs] += carry;
+		t[num_limbs + 1] = t[num_limbs] < carry;
+
+		// t = (t + m * modulus) / 2^64
+		// m is chosen such that the least significant limb becomes 0.
+		const limb_t m = t[0] * modulus_inverse;
+		limb_t discarded = 0;
+		multiply_add(m, modulus[0], t[0], 0, carry, discarded);
+		for (int j = 1; j < num_limbs; ++j)
+		{
+			multiply_add(m, modulus[j], t[j], carry, carry, t[j - 1]);
+		}
+		t[num_limbs - 1] = t[num_limbs] + carry;
+		t[num_limbs] = t[num_limbs + 1] + (t[num_limbs - 1] < carry);
+	}
+	// Now t < 2 * modulus. One conditional subtraction brings it to the range [0, modulus)
+	limb_t borrow = 0;
+	for (int j = 0; j < num_limbs; ++j)
+	{
+		const limb_t difference = t[j] - modulus[j];
+		const limb_t next_borrow = (t[j] < modulus[j]) | (difference < borrow);
+		result[j] = difference - borrow;
+		borrow = next_borrow;
+	}
+	const bool t_smaller_than_modulus = t[num_limbs] < borrow;
+	if (t_smaller_than_modulus)
+	{
+		std::copy(t, t + num_limbs, result);
+	}
+}
+
+void cryptb::montgomery_kernel::double_mod(limb_t* const x, const limb_t* const modulus, const int num_limbs)
+{
+	const limb_t carry_out = x[num_limbs - 1] >> 63;
+	for (int j = num_limbs - 1; j > 0; --j)
+	{
+		x[j] = (x[j] << 1) | (x[j - 1] >> 63);
+	}
+	x[0] <<= 1;
+	bool greater_or_equal = carry_out != 0;
+	if (!greater_or_equal)
+	{
+		greater_or_equal = true;
+		for (int j = num_limbs - 1; j >= 0; --j)
+		{
+			if (x[j] != modulus[j])
+			{
+				greater_or_equal = x[j] > modulus[j];
+				break;
+			}
+		}
+	}
+	if (greater_or_equal)
+	{
+		limb_t borrow = 0;
+		for (int j = 0; j < num_limbs; ++j)
+		{
+			const limb_t difference = x[j] - modulus[j];
+			const limb_t next_borrow = (x[j] < modulus[j]) | (difference < borrow);
+			x[j] = difference - borrow;
+			borrow = next_borrow;
+		}
+	}
+}
+
+template <typename int_T>
+void cryptb::montgomery_context<int_T>::to_limbs(const int_T& num, limbs_t& limbs, const int num_limbs)
+{
+	limbs.clear();
+	// "msv_first == false" means the least significant limb comes first
+	// export_bits only supports the cpp_int backends.
+	using export_t = typename std::conditional<is_cpp_int_number<int_T>::value, const int_T&, boost::multiprecision::cpp_int>::type;
+	const export_t exported = static_cast<export_t>(num);
+	boost::multiprecision::export_bits(exported, std::back_inserter(limbs), 64, false);
+	limbs.resize(num_limbs, 0);
+}
+
+template <typename int_T>
+int_T cryptb::montgomery_context<int_T>::from_limbs(const limbs_t& limbs)
+{
+	// import_bits only supports the cpp_int backends.
+	using import_t = typename std::conditional<is_cpp_int_number<int_T>::value, int_T, boost::multiprecision::cpp_int>::type;
+	import_t num{ 0 };
+	boost::multiprecision::import_bits(num, limbs.begin(), limbs.end(), 64, false);
+	return static_cast<int_T>(num);
+}
+
+template <typename int_T>
+cryptb::montgomery_context<int_T>::montgomery_context(const int_T& modulus)
+{
+	if (!montgomery_context::is_supported_modulus(modulus))
+	{
+		throw std::invalid_argument("Error in function \"cryptb::montgomery_context::montgomery_context\"."
+			" The modulus must be odd and at least 3.");
+	}
+	this->m_modulus = modulus;
+	const int num_bits = static_cast<int>(boost::multiprecision::msb(modulus)) + 1;
+	const int num_limbs = (num_bits + 63) / 64;
+	this->m_num_limbs = num_limbs;
+	montgomery_context::to_limbs(modulus, this->m_modulus_limbs, num_limbs);
+	this->m_modulus_inverse = montgomery_kernel::negated_inverse(this->m_modulus_limbs[0]);
+
+	// R modulo N
+	// Start from 2^(num_bits - 1) which is already smaller than N
+	// and keep doubling until reaching 2^(64 * num_limbs).
+	this->m_one.assign(num_limbs, 0);
+	this->m_one[(num_bits - 1) / 64] = static_cast<limb_t>(1) << ((num_bits - 1) % 64);
+	for (int power = num_bits - 1; power < 64 * num_limbs; ++power)
+	{
+		montgomery_kernel::double_mod(this->m_one.data(), this->m_modulus_limbs.data(), num_limbs);
+	}
+
+	// R^2 modulo N
+	// Doubling R "num_limbs" times gives (2^num_limbs) in Montgomery form.
+	// Squaring that 6 times in Montgomery form gives 2^(64 * num_limbs) == R
+	// in Montgomery form, which is R^2 modulo N.
+	// Much cheaper than doubling another (64 * num_limbs) times.
+	this->m_r_squared = this->m_one;
+	for (int power = 0; power < num_limbs; ++power)
+	{
+		montgomery_kernel::double_mod(this->m_r_squared.data(), this->m_modulus_limbs.data(), num_limbs);
+	}
+	limbs_t scratch;
+	scratch.resize(num_limbs + 2);
+	for (int squaring = 0; squaring < 6; ++squaring)
+	{
+		montgomery_kernel::multiply(this->m_r_squared.data(), this->m_r_squared.data(), this->m_r_squared.data(),
+			this->m_modulus_limbs.data(), this->m_modulus_inverse, num_limbs, scratch.data());
+	}
+}
+
+template <typename int_T>
+int_T cryptb::montgomery_context<int_T>::powm(const int_T& base, const int_T& exponent) const
+{
+	if (this->empty())
+	{
+		throw std::logic_error("Error in function \"cryptb::montgomery_context::powm\"."
+			" The context is empty.");
+	}
+	if (exponent < 0)
+	{
+		throw std::invalid_argument("Error in function \"cryptb::montgomery_context::powm\"."
+			" Negative exponents aren\'t supported.");
+	}
+	if (exponent == 0)
+		return int_T{ 1 };
+	const int num_limbs = this->m_num_limbs;
+	auto multiply = [this, num_limbs](limb_t* const result, const limb_t* const a, const limb_t* const b, limb_t* const scratch) -> void
+	{
+		montgomery_kernel::multiply(result, a, b, this->m_modulus_limbs.data(), this->m_modulus_inverse, num_limbs, scratch);
+	};
+	limbs_t scratch;
+	scratch.resize(num_limbs + 2);
+
+	limbs_t base_limbs;
+	if (base >= this->m_modulus)
+		montgomery_context::to_limbs(static_cast<int_T>(base % this->m_modulus), base_limbs, num_limbs);
+	else
+		montgomery_context::to_limbs(base, base_limbs, num_limbs);
+
+	const int num_exponent_bits = static_cast<int>(boost::multiprecision::msb(exponent)) + 1;
+	limbs_t exponent_limbs;
+	montgomery_context::to_limbs(exponent, exponent_limbs, (num_exponent_bits + 63) / 64);
+
+	// Small exponents (such as e == 65537) are done bit by bit, that's
+	// just squarings plus one multiplication per set bit.
+	// Larger exponents amortize a bigger table of powers over more bits.
+	const int window_bits =
+		num_exponent_bits > 512 ? montgomery_context::max_window_bits :
+		num_exponent_bits > 128 ? 4 :
+		num_exponent_bits > 32 ? 3 : 1;
+
+	// table[i] == base^i in Montgomery form. table[0] is never used.
+	std::array<limbs_t, 1 << montgomery_context::max_window_bits> table;
+	table[1].resize(num_limbs);
+	multiply(table[1].data(), base_limbs.data(), this->m_r_squared.data(), scratch.data());
+	for (int index = 2; index < (1 << window_bits); ++index)
+	{
+		table[index].resize(num_limbs);
+		multiply(table[index].data(), table[index - 1].data(), table[1].data(), scratch.data());
+	}
+
+	auto exponent_bit = [&exponent_limbs, num_exponent_bits](const int index_bit) -> limb_t
+	{
+		if (index_bit >= num_exponent_bits)
+			return 0;
+		return (exponent_limbs[index_bit / 64] >> (index_bit % 64)) & 1;
+	};
+
+	// Left to right: for every window square "window_bits" times and then
+	// multiply by the power of the base that the window's bits select.
+	limbs_t accumulator = this->m_one;
+	bool accumulator_is_one = true;
+	const int num_windows = (num_exponent_bits + window_bits - 1) / window_bits;
+	for (int window = num_windows - 1; window >= 0; --window)
+	{
+		if (!accumulator_is_one)
+		{
+			for (int squaring = 0; squaring < window_bits; ++squaring)
+			{
+				multiply(accumulator.data(), accumulator.data(), accumulator.data(), scratch.data());
+			}
+		}
+		limb_t selected = 0;
+		for (int index_in_window = window_bits - 1; index_in_window >= 0; --index_in_window)
+		{
+			selected = (selected << 1) | exponent_bit(window * window_bits + index_in_window);
+		}
+		if (selected != 0)
+		{
+			if (accumulator_is_one)
+				accumulator = table[selected];
+			else
+				multiply(accumulator.data(), accumulator.data(), table[selected].data(), scratch.data());
+			accumulator_is_one = false;
+		}
+	}
+
+	// Out of Montgomery form: multiply by a plain 1
+	limbs_t plain_one;
+	plain_one.resize(num_limbs, 0);
+	plain_one[0] = 1;
+	multiply(accumulator.data(), accumulator.data(), plain_one.data(), scratch.data());
+	return montgomery_context::from_limbs(accumulator);
+}
+
+template <typename int_T>
+int_T cryptb::montgomery_context<int_T>::powm_65537(const int_T& base) const
+{
+	if (this->empty())
+	{
+		throw std::logic_error("Error in function \"cryptb::montgomery_context::powm_65537\"."
+			" The context is empty.");
+	}
+	const int num_limbs = this->m_num_limbs;
+	auto multiply = [this, num_limbs](limb_t* const result, const limb_t* const a, const limb_t* const b, limb_t* const scratch) -> void
+	{
+		montgomery_kernel::multiply(result, a, b, this->m_modulus_limbs.data(), this->m_modulus_inverse, num_limbs, scratch);
+	};
+	limbs_t scratch;
+	scratch.resize(num_limbs + 2);
+	limbs_t base_limbs;
+	if (base >= this->m_modulus)
+		montgomery_context::to_limbs(static_cast<int_T>(base % this->m_modulus), base_limbs, num_limbs);
+	else
+		montgomery_context::to_limbs(base, base_limbs, num_limbs);
+	// Into Montgomery form
+	multiply(base_limbs.data(), base_limbs.data(), this->m_r_squared.data(), scratch.data());
+	limbs_t accumulator = base_limbs;
+	for (int squaring = 0; squaring < 16; ++squaring)
+	{
+		multiply(accumulator.data(), accumulator.data(), accumulator.data(), scratch.data());
+	}
+	multiply(accumulator.data(), accumulator.data(), base_limbs.data(), scratch.data());
+	// Out of Montgomery form: multiply by a plain 1
+	limbs_t plain_one;
+	plain_one.resize(num_limbs, 0);
+	plain_one[0] = 1;
+	multiply(accumulator.data(), accumulator.data(), plain_one.data(), scratch.data());
+	return montgomery_context::from_limbs(accumulator);
+}
+
+template class cryptb::montgomery_context<boost::multiprecision::cpp_int>;
+template class cryptb::montgomery_context<cryptb::fixed_uint<1024>>;
+template class cryptb::montgomery_context<cryptb::fixed_uint<2048>>;
+template class cryptb::montgomery_context<cryptb::fixed_uint<3072>>;
+template class cryptb::montgomery_context<cryptb::fixed_uint<4096>>;
+#ifdef CRYPTB_WITH_GMP
+template class cryptb::montgomery_context<boost::multiprecision::mpz_int>;
+#endif
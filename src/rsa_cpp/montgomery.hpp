@@ -0,0 +1,142 @@
+#pragma once
+
+#include "fixed_uint.hpp"
+#include "number_traits.hpp"
+#include <boost/multiprecision/cpp_int.hpp>
+#include <boost/container/static_vector.hpp>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace cryptb
+{
+	// Word-level Montgomery arithmetic on little-endian arrays of 64-bit limbs
+	// (index 0 is the least significant limb).
+	//
+	// Everything here works on raw pointers so that it can be shared by all
+	// of the montgomery_context instantiations.
+	class montgomery_kernel
+	{
+	public:
+		using limb_t = std::uint64_t;
+
+		// Returns -(n0 ^ -1) modulo 2^64
+		// "n0" must be odd (it's the least significant limb of an odd modulus).
+		static limb_t negated_inverse(const limb_t n0);
+
+		// CIOS (Coarsely Integrated Operand Scanning) Montgomery multiplication:
+		// result = (a * b * (R ^ -1)) modulo modulus
+		// where R == 2 ^ (64 * num_limbs).
+		//
+		// a and b must be smaller than modulus.
+		// "result" is allowed to be the same array as "a" or "b".
+		// "scratch" must have room for (num_limbs + 2) limbs.
+		static void multiply(
+			limb_t* const result,
+			const limb_t* const a,
+			const limb_t* const b,
+			const limb_t* const modulus,
+			const limb_t modulus_inverse,
+			const int num_limbs,
+			limb_t* const scratch);
+
+		// x = (2 * x) modulo modulus
+		// x must be smaller than modulus.
+		static void double_mod(limb_t* const x, const limb_t* const modulus, const int num_limbs);
+	};
+
+	// Precomputed state for doing many modular exponentiations with the same odd modulus N.
+	//
+	// The constructor pays for the setup once:
+	//	-N ^ -1 modulo 2 ^ 64
+	//	R modulo N (which is 1 in Montgomery form)
+	//	R ^ 2 modulo N (to convert numbers into Montgomery form)
+	// After that, every multiplication in "powm" is a single montgomery_kernel::multiply
+	// instead of a multiplication followed by a division.
+	//
+	// When "int_T" is a fixed_uint there are no heap allocations at all (not even in the constructor).
+	//
+	// Only the instantiations declared with "extern template" at the bottom of this file
+	// are compiled into the library.
+	template <typename int_T>
+	class montgomery_context
+	{
+	public:
+		using limb_t = montgomery_kernel::limb_t;
+
+	private:
+		static constexpr bool is_fixed_width = std::numeric_limits<int_T>::is_bounded;
+		// Plus 2 for the scratch space of montgomery_kernel::multiply
+		static constexpr int max_limbs = is_fixed_width ? (std::numeric_limits<int_T>::digits + 63) / 64 + 2 : 1;
+
+		// Fixed capacity on the stack for fixed-width integers, heap otherwise.
+		using limbs_t = typename std::conditional<is_fixed_width,
+			boost::container::static_vector<limb_t, max_limbs>,
+			std::vector<limb_t>>::type;
+
+		// Window sizes of more than 5 bits make the table of powers
+		// more expensive than what it saves for RSA sized exponents.
+		static constexpr int max_window_bits = 5;
+
+		int_T m_modulus{ 0 };
+		int m_num_limbs = 0;
+		// -N ^ -1 modulo 2 ^ 64
+		limb_t m_modulus_inverse = 0;
+		limbs_t m_modulus_limbs;
+		// R modulo N
+		limbs_t m_one;
+		// R ^ 2 modulo N
+		limbs_t m_r_squared;
+
+		static void to_limbs(const int_T& num, limbs_t& limbs, const int num_limbs);
+		static int_T from_limbs(const limbs_t& limbs);
+
+	public:
+		// An empty context (modulus == 0) that can't be used for anything
+		// until it's assigned a real one.
+		montgomery_context() = default;
+		montgomery_context(const montgomery_context&) = default;
+		montgomery_context(montgomery_context&&) = default;
+		montgomery_context& operator=(const montgomery_context&) = default;
+		montgomery_context& operator=(montgomery_context&&) = default;
+
+		// "modulus" must be odd and at least 3.
+		explicit montgomery_context(const int_T& modulus);
+
+		bool empty() const
+		{
+			return this->m_num_limbs == 0;
+		}
+
+		const int_T& get_modulus() const
+		{
+			return this->m_modulus;
+		}
+
+		// Montgomery only works with an odd modulus.
+		static bool is_supported_modulus(const int_T& modulus)
+		{
+			return modulus >= 3 && boost::multiprecision::bit_test(modulus, 0);
+		}
+
+		// powm(base, exponent, modulus) with a fixed window exponentiation.
+		// "base" is reduced modulo the modulus first if it needs to be.
+		// "exponent" must not be negative.
+		int_T powm(const int_T& base, const int_T& exponent) const;
+
+		// powm(base, 65537) which is the e of every key this library generates.
+		// 65537 == 2^16 + 1 so that's exactly 16 squarings and one multiplication,
+		// without scanning the exponent or building a table of powers.
+		int_T powm_65537(const int_T& base) const;
+	};
+
+	extern template class montgomery_context<boost::multiprecision::cpp_int>;
+	extern template class montgomery_context<fixed_uint<1024>>;
+	extern template class montgomery_context<fixed_uint<2048>>;
+	extern template class montgomery_context<fixed_uint<3072>>;
+	extern template class montgomery_context<fixed_uint<4096>>;
+#ifdef CRYPTB_WITH_GMP
+	extern template class montgomery_context<boost::multiprecision::mpz_int>;
+#endif
+}
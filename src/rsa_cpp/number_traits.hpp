@@ -0,0 +1,45 @@
+#pragma once
+
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cstdint>
+#include <type_traits>
+#ifdef CRYPTB_WITH_GMP
+#include <boost/multiprecision/gmp.hpp>
+#endif
+
+// The templates of this library take the multiprecision number type as "int_T":
+//	boost::multiprecision::cpp_int (the default everywhere)
+//	cryptb::fixed_uint<Bits> (the fixed-width cpp_int backends, see fixed_uint.hpp)
+//	boost::multiprecision::mpz_int (GMP), only when built with the CMake option CRYPTB_WITH_GMP
+// Which number types each template supports is listed at the bottom of its header.
+
+namespace cryptb
+{
+	// True for the numbers with a cpp_int_backend (cpp_int and fixed_uint).
+	// The library can only work on the limbs of these directly.
+	template <typename int_T>
+	struct is_cpp_int_number : std::false_type {};
+
+	template <unsigned MinBits, unsigned MaxBits, boost::multiprecision::cpp_integer_type SignType, boost::multiprecision::cpp_int_check_type Checked, class Allocator, boost::multiprecision::expression_template_option ET>
+	struct is_cpp_int_number<boost::multiprecision::number<boost::multiprecision::cpp_int_backend<MinBits, MaxBits, SignType, Checked, Allocator>, ET>> : std::true_type {};
+
+	// The big-endian bytes [first, last) as a number of type "int_T":
+	// { 0x0f, 0xf0, 0x12, 0x30 } is 0xff01230
+	//
+	// boost::multiprecision::import_bits only supports the cpp_int backends,
+	// other backends are converted from a cpp_int.
+	template <typename int_T>
+	int_T number_from_bytes(const std::uint8_t* const first, const std::uint8_t* const last)
+	{
+		if constexpr (is_cpp_int_number<int_T>::value)
+		{
+			int_T result{ 0 };
+			boost::multiprecision::import_bits(result, first, last, 8, true);
+			return result;
+		}
+		else
+		{
+			return static_cast<int_T>(number_from_bytes<boost::multiprecision::cpp_int>(first, last));
+		}
+	}
+}
@@ -1,25 +1,476 @@
 #include "prime.hpp"
+#include "trace.hpp"
 
-// Miller-Rabin prime test algorithm.
-#include <boost/multiprecision/miller_rabin.hpp>
+#include "montgomery.hpp"
+#include <boost/random/uniform_int_distribution.hpp>
+#include <cmath>
+#include <algorithm>
 #include <random>
+#include <array>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <exception>
 
-boost::multiprecision::cpp_int cryptb::prime::gen_random(const int num_bytes, random_engine& engine)
-{
-	if (num_bytes <= 0)
-		throw std::invalid_argument("Error in function \"cryptb::prime::gen_random\"."
-			" The argument: \"num_bytes\" <= 0. There is no prime number with that number of bytes.");
-	boost::multiprecision::cpp_int candidate;
-	// TODO: Use seed_seq here to seed the std::mt19937_64 engine better.
-	// Also, don't allocate the std::mt19937_64 engine on the stack because
-	// it's more than 1000 bytes long.
-	const auto seed = engine.operator()(sizeof(std::mt19937_64::result_type));
-	std::mt19937_64 miller_rabin_engine(static_cast<std::mt19937_64::result_type>(seed));
-	do
-	{
-		candidate = engine.operator()(num_bytes);
-		// 64 Should be enough. The higher the number of trials, the lower the probability is for a false positive.
-		// Note: making this number lower will significantly improve performance.
-	} while (boost::multiprecision::miller_rabin_test(candidate, 64, miller_rabin_engine) == false);
-	return candidate;
+// The first "num_sieve_primes" odd primes: 3, 5, 7, 11, ...
+// Calculated at compile time with the sieve of Eratosthenes.
+static constexpr int num_sieve_primes = 2048;
+// The 2049th prime is 17881, so everything fits in 16 bits.
+static constexpr int sieve_limit = 17882;
+static constexpr std::array<std::uint16_t, num_sieve_primes> make_sieve_primes()
+{
+	std::array<bool, sieve_limit> is_composite{};
+	std::array<std::uint16_t, num_sieve_primes> result{};
+	int count = 0;
+	for (int num = 2; num < sieve_limit && count < num_sieve_primes; ++num)
+	{
+		if (is_composite[num])
+			continue;
+		for (int multiple = num * 2; multiple < sieve_limit; multiple += num)
+			is_composite[multiple] = true;
+		// Candidates are always odd, no need to check 2.
+		if (num != 2)
+			result[count++] = static_cast<std::uint16_t>(num);
+	}
+	return result;
+}
+static constexpr std::array<std::uint16_t, num_sieve_primes> sieve_primes = make_sieve_primes();
+static_assert(sieve_primes[num_sieve_primes - 1] == 17881, "Sieve limit is too small for the requested number of primes");
+
+namespace
+{
+	std::atomic<cryptb::primality_test>& selected_primality_test()
+	{
+		static std::atomic<cryptb::primality_test> selected{ cryptb::primality_test::miller_rabin };
+		return selected;
+	}
+
+	// Jacobi symbol (a / m) for an odd m > 0
+	int jacobi(std::uint64_t a, std::uint64_t m)
+	{
+		int result = 1;
+		a %= m;
+		while (a != 0)
+		{
+			while (a % 2 == 0)
+			{
+				a /= 2;
+				const std::uint64_t m_mod_8 = m % 8;
+				if (m_mod_8 == 3 || m_mod_8 == 5)
+					result = -result;
+			}
+			std::swap(a, m);
+			if (a % 4 == 3 && m % 4 == 3)
+				result = -result;
+			a %= m;
+		}
+		return m == 1 ? result : 0;
+	}
+
+	// Everything the probable prime tests of one odd candidate "n" > 3 share
+	template <typename int_T>
+	class candidate_test
+	{
+		const int_T m_n;
+		const int_T m_n_minus_1;
+		// n - 1 == m_d * 2 ^ m_s with m_d odd
+		int_T m_d;
+		unsigned m_s = 0;
+		// Empty when Montgomery isn't used (not with GMP, its own powm is faster)
+		cryptb::montgomery_context<int_T> m_context;
+
+		// x modulo n in [0, n), also for a negative x
+		int_T reduce(const int_T& x) const
+		{
+			int_T result = x % this->m_n;
+			if (result < 0)
+				result += this->m_n;
+			return result;
+		}
+
+		// x / 2 modulo n, for x in [0, n)
+		int_T halve(const int_T& x) const
+		{
+			return boost::multiprecision::bit_test(x, 0) ? int_T((x + this->m_n) >> 1) : int_T(x >> 1);
+		}
+
+		// (a / n) for a small "a" (the Jacobi symbol, with quadratic reciprocity)
+		int jacobi_of_small(const long long a) const
+		{
+			int result = 1;
+			std::uint64_t magnitude = static_cast<std::uint64_t>(a < 0 ? -a : a);
+			const unsigned n_mod_8 = static_cast<unsigned>(this->m_n % 8);
+			// (-1 / n)
+			if (a < 0 && n_mod_8 % 4 == 3)
+				result = -result;
+			// (2 / n)
+			while (magnitude % 2 == 0)
+			{
+				magnitude /= 2;
+				if (n_mod_8 == 3 || n_mod_8 == 5)
+					result = -result;
+			}
+			if (magnitude == 1)
+				return result;
+			// (magnitude / n) == (n / magnitude), negated when both are 3 modulo 4
+			if (magnitude % 4 == 3 && n_mod_8 % 4 == 3)
+				result = -result;
+			return result * jacobi(static_cast<std::uint64_t>(this->m_n % magnitude), magnitude);
+		}
+
+	public:
+		explicit candidate_test(const int_T& n) : m_n(n), m_n_minus_1(n - 1), m_d(n - 1)
+		{
+			while (!boost::multiprecision::bit_test(this->m_d, 0))
+			{
+				this->m_d >>= 1;
+				++this->m_s;
+			}
+			if constexpr (cryptb::is_cpp_int_number<int_T>::value)
+				this->m_context = cryptb::montgomery_context<int_T>(n);
+		}
+
+		// Strong probable prime test (one Miller-Rabin round) to "base", 2 <= "base" <= n - 2
+		bool is_strong_probable_prime(const int_T& base) const
+		{
+			int_T x = this->m_context.empty()
+				? int_T(boost::multiprecision::powm(base, this->m_d, this->m_n))
+				: this->m_context.powm(base, this->m_d);
+			if (x == 1 || x == this->m_n_minus_1)
+				return true;
+			for (unsigned index = 1; index < this->m_s; ++index)
+			{
+				x = x * x % this->m_n;
+				if (x == this->m_n_minus_1)
+					return true;
+				if (x == 1)
+					return false;
+			}
+			return false;
+		}
+
+		// Strong Lucas probable prime test with Selfridge's parameters:
+		// D is the first of 5, -7, 9, -11, ... with (D / n) == -1, P == 1 and Q == (1 - D) / 4.
+		// With n + 1 == d * 2 ^ s (d odd), passes when U(d) == 0 or V(d * 2 ^ r) == 0 for some 0 <= r < s.
+		bool is_strong_lucas_probable_prime() const
+		{
+			// No D exists for a perfect square
+			const int_T root = boost::multiprecision::sqrt(this->m_n);
+			if (root * root == this->m_n)
+				return false;
+			long long D = 5;
+			while (true)
+			{
+				const int symbol = this->jacobi_of_small(D);
+				if (symbol == -1)
+					break;
+				// |D| shares a factor with n
+				if (symbol == 0 && this->m_n != static_cast<unsigned long long>(D < 0 ? -D : D))
+					return false;
+				D = D > 0 ? -(D + 2) : -D + 2;
+			}
+			const int_T D_number = D;
+			const int_T Q = this->reduce(int_T((1 - D) / 4));
+
+			int_T d = this->m_n + 1;
+			unsigned s = 0;
+			while (!boost::multiprecision::bit_test(d, 0))
+			{
+				d >>= 1;
+				++s;
+			}
+			// U(k), V(k) and Q ^ k for k == 1, then for the bits of d from the most significant one down:
+			// U(2k) == U(k) * V(k), V(2k) == V(k) ^ 2 - 2 * Q ^ k,
+			// U(k + 1) == (P * U(k) + V(k)) / 2, V(k + 1) == (D * U(k) + P * V(k)) / 2
+			int_T U = 1;
+			int_T V = 1;
+			int_T Q_k = Q;
+			for (unsigned bit = static_cast<unsigned>(boost::multiprecision::msb(d)); bit-- > 0;)
+			{
+				U = U * V % this->m_n;
+				V = this->reduce(int_T(V * V - 2 * Q_k));
+				Q_k = Q_k * Q_k % this->m_n;
+				if (boost::multiprecision::bit_test(d, bit))
+				{
+					const int_T next_U = this->halve(this->reduce(int_T(U + V)));
+					V = this->halve(this->reduce(int_T(D_number * U + V)));
+					U = next_U;
+					Q_k = Q_k * Q % this->m_n;
+				}
+			}
+			if (U == 0 || V == 0)
+				return true;
+			for (unsigned index = 1; index < s; ++index)
+			{
+				V = this->reduce(int_T(V * V - 2 * Q_k));
+				if (V == 0)
+					return true;
+				Q_k = Q_k * Q_k % this->m_n;
+			}
+			return false;
+		}
+	};
+}
+
+template <typename int_T>
+cryptb::primality_test cryptb::basic_prime<int_T>::get_primality_test()
+{
+	return selected_primality_test().load(std::memory_order_relaxed);
+}
+
+template <typename int_T>
+void cryptb::basic_prime<int_T>::set_primality_test(const primality_test test)
+{
+	selected_primality_test().store(test, std::memory_order_relaxed);
+}
+
+template <typename int_T>
+int cryptb::basic_prime<int_T>::get_miller_rabin_rounds(const unsigned num_bits)
+{
+	// Damgard, Landrock and Pomerance, "Average case error estimates for the strong probable prime test" (1993):
+	// the probability that a random odd k-bit composite (k >= 21) passes t rounds with random bases is less than
+	//	k^2 * 4^(2 - sqrt(k))                                                       for t == 1
+	//	k^(3/2) * 2^t * t^(-1/2) * 4^(2 - sqrt(t * k))                              for t == 2 (k >= 88) and 3 <= t <= k / 9
+	//	(7/20) * k * 2^(-5t) + (1/7) * k^(15/4) * 2^(-k/2 - 2t) + 12 * k * 2^(-k/4 - 3t)  for k / 9 <= t <= k / 4
+	//	(1/7) * k^(15/4) * 2^(-k/2 - 2t)                                            for t >= k / 4
+	// The bounds don't apply to tiny candidates, they get the 64 rounds of the worst case (4^-64).
+	constexpr int max_rounds = 64;
+	constexpr double target_log2 = -128;
+	if (num_bits < 21)
+		return max_rounds;
+	const double k = static_cast<double>(num_bits);
+	const double log2_k = std::log2(k);
+	for (int t = 1; t <= max_rounds; ++t)
+	{
+		// log2 of the smallest bound that applies
+		double bound_log2 = 0;
+		if (t == 1)
+			bound_log2 = std::min(bound_log2, 2 * log2_k + 2 * (2 - std::sqrt(k)));
+		if ((t == 2 && k >= 88) || (t >= 3 && t <= k / 9))
+			bound_log2 = std::min(bound_log2, 1.5 * log2_k + t - 0.5 * std::log2(t) + 2 * (2 - std::sqrt(t * k)));
+		if (t >= k / 9 && t <= k / 4)
+			bound_log2 = std::min(bound_log2, std::log2(
+				7.0 / 20 * k * std::exp2(-5.0 * t)
+				+ 1.0 / 7 * std::pow(k, 3.75) * std::exp2(-k / 2 - 2.0 * t)
+				+ 12 * k * std::exp2(-k / 4 - 3.0 * t)));
+		if (t >= k / 4)
+			bound_log2 = std::min(bound_log2, std::log2(1.0 / 7) + 3.75 * log2_k - k / 2 - 2.0 * t);
+		if (bound_log2 <= target_log2)
+			return t;
+	}
+	return max_rounds;
 }
+
+template <typename int_T>
+int_T cryptb::basic_prime<int_T>::gen_random(const int num_bytes, random_engine& engine, keygen_stats* const stats)
+{
+	const std::atomic<bool> never_stop{ false };
+	return basic_prime::gen_random(num_bytes, engine, never_stop, stats).get();
+}
+
+namespace
+{
+	// The body of basic_prime::gen_random. Also gives up when "also_stop_requested"
+	// (if it isn't nullptr) is set, so that gen_random_parallel can stop its threads
+	// both when one of them wins and when its caller asks it to.
+	template <typename int_T>
+	boost::optional<int_T> search_prime(const int num_bytes, cryptb::random_engine& engine, const std::atomic<bool>& stop_requested,
+		const std::atomic<bool>* const also_stop_requested, cryptb::keygen_stats* const stats)
+	{
+		using namespace cryptb;
+		if (num_bytes <= 0)
+			throw std::invalid_argument("Error in function \"cryptb::prime::gen_random\"."
+				" The argument: \"num_bytes\" <= 0. There is no prime number with that number of bytes.");
+		const unsigned num_bits = static_cast<unsigned>(num_bytes) * 8;
+		int_T candidate;
+		// TODO: Use seed_seq here to seed the std::mt19937_64 engine better.
+		// Also, don't allocate the std::mt19937_64 engine on the stack because
+		// it's more than 1000 bytes long.
+		const auto seed = engine.operator()(sizeof(std::mt19937_64::result_type));
+		std::mt19937_64 miller_rabin_engine(static_cast<std::mt19937_64::result_type>(seed));
+		const primality_test test = basic_prime<int_T>::get_primality_test();
+		const int num_miller_rabin_rounds = basic_prime<int_T>::get_miller_rabin_rounds(num_bits);
+
+		// Every candidate is at least 0b11000...0001 because of the forced bits.
+		// Only use small primes that are smaller than that, otherwise
+		// we'd reject a candidate for being divisible by itself.
+		const unsigned smallest_candidate_msb = num_bits - 1;
+		int num_usable_sieve_primes = num_sieve_primes;
+		if (smallest_candidate_msb < 16)
+		{
+			const unsigned smallest_candidate = (3u << (num_bits - 2)) | 1u;
+			num_usable_sieve_primes = 0;
+			while (num_usable_sieve_primes < num_sieve_primes && sieve_primes[num_usable_sieve_primes] < smallest_candidate)
+				++num_usable_sieve_primes;
+		}
+
+		// Walking further than this from the random starting point means we're
+		// in an unusually large prime gap (the average gap is about 0.7 * num_bits).
+		// Better to just pick a new starting point.
+		constexpr std::uint32_t max_delta = 1 << 16;
+
+		// Residues of the starting point modulo each of the small primes.
+		// The residue of (start + delta) is (residue + delta) modulo the small prime,
+		// so there's no need to divide the big number again for every candidate.
+		std::array<std::uint16_t, num_sieve_primes> residues{};
+		// Counted locally (that's just a few increments per candidate)
+		// and only handed over to "stats" on the way out.
+		keygen_stats counts;
+		auto report = [stats, &counts]() -> void
+		{
+			if (stats != nullptr)
+				*stats += counts;
+		};
+		while (true)
+		{
+			++counts.num_random_starts;
+			// One random number per starting point instead of one per candidate.
+			int_T start = engine.operator()<int_T>(num_bytes);
+			// The two most significant bits are set so that the product of two
+			// such primes always has exactly twice as many bits.
+			boost::multiprecision::bit_set(start, num_bits - 1);
+			boost::multiprecision::bit_set(start, num_bits - 2);
+			// Even numbers (other than 2) are never prime
+			boost::multiprecision::bit_set(start, 0);
+			for (int index = 0; index < num_usable_sieve_primes; ++index)
+			{
+				residues[index] = static_cast<std::uint16_t>(static_cast<unsigned>(start % sieve_primes[index]));
+			}
+			for (std::uint32_t delta = 0; delta < max_delta; delta += 2)
+			{
+				// Cheap enough to check for every candidate
+				if (stop_requested.load(std::memory_order_relaxed)
+					|| (also_stop_requested != nullptr && also_stop_requested->load(std::memory_order_relaxed)))
+				{
+					report();
+					return boost::none;
+				}
+				++counts.num_candidates;
+				bool divisible_by_small_prime = false;
+				for (int index = 0; index < num_usable_sieve_primes; ++index)
+				{
+					if ((residues[index] + delta) % sieve_primes[index] == 0)
+					{
+						divisible_by_small_prime = true;
+						break;
+					}
+				}
+				if (divisible_by_small_prime)
+					continue;
+				candidate = start + delta;
+				// Walked past the requested number of bytes
+				if (boost::multiprecision::msb(candidate) >= num_bits)
+					break;
+				++counts.num_primality_tests;
+				bool is_probable_prime = false;
+				{
+					CRYPTB_TRACE_SCOPE(trace::event::miller_rabin_test);
+					const candidate_test<int_T> candidate_tester{ candidate };
+					// Almost every composite fails right here, after a single exponentiation
+					++counts.num_miller_rabin_rounds;
+					is_probable_prime = candidate_tester.is_strong_probable_prime(2);
+					if (is_probable_prime && test == primality_test::baillie_psw)
+					{
+						++counts.num_lucas_tests;
+						is_probable_prime = candidate_tester.is_strong_lucas_probable_prime();
+					}
+					else if (is_probable_prime)
+					{
+						boost::random::uniform_int_distribution<int_T> random_base(2, candidate - 2);
+						for (int round = 0; round < num_miller_rabin_rounds && is_probable_prime; ++round)
+						{
+							++counts.num_miller_rabin_rounds;
+							is_probable_prime = candidate_tester.is_strong_probable_prime(random_base(miller_rabin_engine));
+						}
+					}
+				}
+				if (is_probable_prime)
+				{
+					++counts.num_primes_found;
+					report();
+					return candidate;
+				}
+			}
+		}
+	}
+}
+
+template <typename int_T>
+boost::optional<int_T> cryptb::basic_prime<int_T>::gen_random(const int num_bytes, random_engine& engine, const std::atomic<bool>& stop_requested, keygen_stats* const stats)
+{
+	return search_prime<int_T>(num_bytes, engine, stop_requested, nullptr, stats);
+}
+
+template <typename int_T>
+int_T cryptb::basic_prime<int_T>::gen_random_parallel(const int num_bytes, random_engine& engine, const int num_threads, keygen_stats* const stats)
+{
+	const std::atomic<bool> never_stop{ false };
+	return basic_prime::gen_random_parallel(num_bytes, engine, num_threads, never_stop, stats).get();
+}
+
+template <typename int_T>
+boost::optional<int_T> cryptb::basic_prime<int_T>::gen_random_parallel(const int num_bytes, random_engine& engine, const int num_threads,
+	const std::atomic<bool>& stop_requested, keygen_stats* const stats)
+{
+	if (num_threads <= 0)
+		throw std::invalid_argument("Error in function \"cryptb::prime::gen_random_parallel\"."
+			" The argument: \"num_threads\" <= 0.");
+	if (num_threads == 1)
+		return basic_prime::gen_random(num_bytes, engine, stop_requested, stats);
+	// Fork all of the engines up front (on this thread) because
+	// random_engine isn't thread-safe.
+	std::vector<random_engine> engines;
+	engines.reserve(num_threads);
+	for (int index = 0; index < num_threads; ++index)
+	{
+		engines.push_back(engine.fork());
+	}
+	// Set by the first thread to finish (whether it found a prime or failed)
+	std::atomic<bool> is_finished{ false };
+	std::mutex result_mutex;
+	boost::optional<int_T> result;
+	std::exception_ptr error;
+	std::vector<std::thread> threads;
+	threads.reserve(num_threads);
+	for (int index = 0; index < num_threads; ++index)
+	{
+		threads.emplace_back([&, index]() -> void
+		{
+			try
+			{
+				keygen_stats thread_stats;
+				boost::optional<int_T> found = search_prime<int_T>(num_bytes, engines[index], is_finished, &stop_requested,
+					stats != nullptr ? &thread_stats : nullptr);
+				const std::lock_guard<std::mutex> lock{ result_mutex };
+				if (stats != nullptr)
+					*stats += thread_stats;
+				if (found != boost::none && result == boost::none)
+					result = std::move(found);
+			}
+			catch (...)
+			{
+				const std::lock_guard<std::mutex> lock{ result_mutex };
+				if (!error)
+					error = std::current_exception();
+			}
+			// Either way, the other threads have nothing left to do.
+			is_finished.store(true, std::memory_order_relaxed);
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	// All of the threads gave up because of "stop_requested"
+	if (result == boost::none && !error)
+		return boost::none;
+	if (result == boost::none)
+		std::rethrow_exception(error);
+	return result;
+}
+
+template class cryptb::basic_prime<boost::multiprecision::cpp_int>;
+#ifdef CRYPTB_WITH_GMP
+template class cryptb::basic_prime<boost::multiprecision::mpz_int>;
+#endif
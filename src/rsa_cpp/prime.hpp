@@ -1,14 +1,84 @@
 #pragma once
 
 #include "random_engine.hpp"
+#include "number_traits.hpp"
+#include "keygen_stats.hpp"
+#include <boost/optional.hpp>
+#include <atomic>
 
 namespace cryptb
 {
-	class prime
+	// How gen_random decides that a candidate (that no small prime divides) is prime.
+	// Both start with a strong probable prime test to base 2: almost every composite
+	// fails it, so a composite costs a single modular exponentiation.
+	enum class primality_test
+	{
+		// Then Miller-Rabin rounds with random bases, as many as it takes for the probability
+		// of a composite getting through to be at most 2^-128 (which depends on the size of the candidate,
+		// see get_miller_rabin_rounds).
+		miller_rabin,
+		// Then a strong Lucas probable prime test (Baillie-PSW).
+		// No composite that passes it is known, but there's no proven bound either.
+		// The Lucas test costs about as much as two or three Miller-Rabin rounds, so it's cheaper
+		// for the smaller primes (which need more Miller-Rabin rounds).
+		baillie_psw
+	};
+
+	// Prime numbers of type "int_T" (see number_traits.hpp).
+	//
+	// Only the instantiations declared with "extern template" at the bottom of this file
+	// are compiled into the library.
+	template <typename int_T>
+	class basic_prime
 	{
 	public:
 		// Generates regular-old prime number. Not a "safe prime", but a cryptographically secure prime.
 		// RSA doesn't need safe primes anyways.
-		static boost::multiprecision::cpp_int gen_random(const int num_bytes, random_engine& engine);
+		//
+		// The returned prime has exactly "num_bytes" bytes: its two most significant
+		// bits are always set, so multiplying two of them gives exactly twice as many bits.
+		//
+		// Picks a random odd starting point and walks up from it by 2, using a table of
+		// residues modulo the first 2048 odd primes to skip most composites before
+		// running the (expensive) primality test (see primality_test).
+		//
+		// When "stats" isn't nullptr, the work of the search is added to it (see keygen_stats).
+		static int_T gen_random(const int num_bytes, random_engine& engine, keygen_stats* const stats = nullptr);
+
+		// Same as the function above, but gives up and returns boost::none
+		// as soon as it sees that "stop_requested" was set (by another thread).
+		static boost::optional<int_T> gen_random(const int num_bytes, random_engine& engine, const std::atomic<bool>& stop_requested, keygen_stats* const stats = nullptr);
+
+		// Searches for a single prime number on "num_threads" threads at the same time.
+		// Each thread gets its own random_engine forked from "engine".
+		// The first thread to find a prime wins and the others are stopped.
+		//
+		// Unlike gen_random, the result depends on thread timing and not only on the state of "engine".
+		// "stats" gets the work of all of the threads, the ones that lost included.
+		static int_T gen_random_parallel(const int num_bytes, random_engine& engine, const int num_threads, keygen_stats* const stats = nullptr);
+
+		// Same as the function above, but gives up and returns boost::none
+		// as soon as it sees that "stop_requested" was set (by another thread).
+		static boost::optional<int_T> gen_random_parallel(const int num_bytes, random_engine& engine, const int num_threads,
+			const std::atomic<bool>& stop_requested, keygen_stats* const stats = nullptr);
+
+		// The test that gen_random uses, for every basic_prime in the program (whatever "int_T" is).
+		// primality_test::miller_rabin by default.
+		static primality_test get_primality_test();
+		static void set_primality_test(const primality_test test);
+
+		// Random-base Miller-Rabin rounds that primality_test::miller_rabin runs (after the base-2 test)
+		// on a random candidate with "num_bits" bits. From the Damgard-Landrock-Pomerance bound
+		// on the probability that a random composite passes t rounds (the bound that the tables
+		// in the Handbook of Applied Cryptography and in FIPS 186 come from), for 2^-128:
+		// 12 rounds for 512 bits, 6 for 1024 bits, 3 for 2048 bits and up to 64 for the smallest candidates.
+		static int get_miller_rabin_rounds(const unsigned num_bits);
 	};
+
+	using prime = basic_prime<boost::multiprecision::cpp_int>;
+
+	extern template class basic_prime<boost::multiprecision::cpp_int>;
+#ifdef CRYPTB_WITH_GMP
+	extern template class basic_prime<boost::multiprecision::mpz_int>;
+#endif
 };
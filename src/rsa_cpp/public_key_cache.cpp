@@ -0,0 +1,161 @@
+#include "public_key_cache.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <boost/endian/conversion.hpp>
+
+namespace
+{
+	// Hashes the sign and the magnitude of "num".
+	// The limbs are hashed as they are in memory: the digests never leave the process.
+	template <typename int_T>
+	void hash_number(cryptb::sha512& hash, const int_T& num)
+	{
+		if constexpr (cryptb::is_cpp_int_number<int_T>::value)
+		{
+			const auto& backend = num.backend();
+			std::uint8_t header[9]{};
+			header[0] = num < 0 ? 1 : 0;
+			boost::endian::store_big_u64(header + 1, static_cast<std::uint64_t>(backend.size()));
+			hash.update(header, sizeof(header));
+			hash.update(reinterpret_cast<const std::uint8_t*>(backend.limbs()), backend.size() * sizeof(*backend.limbs()));
+		}
+		else
+		{
+			hash_number(hash, static_cast<boost::multiprecision::cpp_int>(num));
+		}
+	}
+}
+
+template <typename int_T>
+std::size_t cryptb::basic_public_key_cache<int_T>::digest_hash::operator()(const sha512::digest_t& digest) const
+{
+	// The first bytes pick the shard, the next ones are just as random.
+	std::size_t result = 0;
+	std::memcpy(&result, digest.data() + 8, sizeof(result));
+	return result;
+}
+
+template <typename int_T>
+cryptb::basic_public_key_cache<int_T>::basic_public_key_cache(const std::size_t capacity, const std::size_t num_shards)
+{
+	if (capacity == 0 || num_shards == 0)
+	{
+		throw std::invalid_argument("Error in function \"cryptb::public_key_cache::public_key_cache\"."
+			" \"capacity\" and \"num_shards\" must be positive.");
+	}
+	this->m_capacity_per_shard = (capacity + num_shards - 1) / num_shards;
+	this->m_shards.reserve(num_shards);
+	for (std::size_t index = 0; index < num_shards; ++index)
+	{
+		this->m_shards.push_back(std::make_unique<shard>());
+	}
+}
+
+template <typename int_T>
+cryptb::sha512::digest_t cryptb::basic_public_key_cache<int_T>::key_digest(const int_T& e, const int_T& N)
+{
+	sha512 hash;
+	hash_number(hash, e);
+	hash_number(hash, N);
+	return hash.digest();
+}
+
+template <typename int_T>
+typename cryptb::basic_public_key_cache<int_T>::entry_ptr cryptb::basic_public_key_cache<int_T>::find_or_insert(const int_T& e, const int_T& N)
+{
+	const sha512::digest_t digest = basic_public_key_cache::key_digest(e, N);
+	std::uint64_t shard_selector = 0;
+	std::memcpy(&shard_selector, digest.data(), sizeof(shard_selector));
+	shard& current = *this->m_shards[shard_selector % this->m_shards.size()];
+	{
+		const std::lock_guard<std::mutex> lock{ current.mutex };
+		const auto found = current.index.find(digest);
+		if (found != current.index.end())
+		{
+			++current.num_hits;
+			current.lru.splice(current.lru.begin(), current.lru, found->second);
+			return found->second->second;
+		}
+		++current.num_misses;
+	}
+	// Set up outside of the lock, the Montgomery setup is the expensive part.
+	// Two threads that miss on the same key at the same time both do it, and the first one wins.
+	std::shared_ptr<entry> created = std::make_shared<entry>();
+	created->is_valid = basic_rsa<int_T>::is_valid_public_key(e, N);
+	if (created->is_valid && basic_rsa<int_T>::use_montgomery(N))
+		created->context = montgomery_context<int_T>(N);
+
+	const std::lock_guard<std::mutex> lock{ current.mutex };
+	const auto found = current.index.find(digest);
+	if (found != current.index.end())
+		return found->second->second;
+	current.lru.emplace_front(digest, std::move(created));
+	current.index.emplace(digest, current.lru.begin());
+	if (current.lru.size() > this->m_capacity_per_shard)
+	{
+		current.index.erase(current.lru.back().first);
+		current.lru.pop_back();
+		++current.num_evictions;
+	}
+	return current.lru.front().second;
+}
+
+template <typename int_T>
+boost::optional<int_T> cryptb::basic_public_key_cache<int_T>::encrypt(const int_T& original_message, const int_T& e, const int_T& N)
+{
+	const entry_ptr found = this->find_or_insert(e, N);
+	if (!found->is_valid || original_message >= N || original_message < 0)
+		return boost::none;
+	return basic_rsa<int_T>::powm_public(found->context, original_message, e, N);
+}
+
+template <typename int_T>
+bool cryptb::basic_public_key_cache<int_T>::is_valid_signature(
+	const int_T& message_hash,
+	const int_T& signature_of_hash,
+	const int_T& e,
+	const int_T& N)
+{
+	// It's the same algorithm. Isn't that convenient!
+	const boost::optional<int_T> result = this->encrypt(signature_of_hash, e, N);
+	if (result == boost::none)
+		return false;
+	return result.get() == message_hash;
+}
+
+template <typename int_T>
+typename cryptb::basic_public_key_cache<int_T>::statistics cryptb::basic_public_key_cache<int_T>::get_statistics() const
+{
+	statistics result;
+	result.capacity = this->m_capacity_per_shard * this->m_shards.size();
+	for (const std::unique_ptr<shard>& current : this->m_shards)
+	{
+		const std::lock_guard<std::mutex> lock{ current->mutex };
+		result.num_hits += current->num_hits;
+		result.num_misses += current->num_misses;
+		result.num_evictions += current->num_evictions;
+		result.size += current->lru.size();
+	}
+	return result;
+}
+
+template <typename int_T>
+void cryptb::basic_public_key_cache<int_T>::clear()
+{
+	for (const std::unique_ptr<shard>& current : this->m_shards)
+	{
+		const std::lock_guard<std::mutex> lock{ current->mutex };
+		current->index.clear();
+		current->lru.clear();
+	}
+}
+
+template class cryptb::basic_public_key_cache<boost::multiprecision::cpp_int>;
+template class cryptb::basic_public_key_cache<cryptb::fixed_uint<1024>>;
+template class cryptb::basic_public_key_cache<cryptb::fixed_uint<2048>>;
+template class cryptb::basic_public_key_cache<cryptb::fixed_uint<3072>>;
+template class cryptb::basic_public_key_cache<cryptb::fixed_uint<4096>>;
+#ifdef CRYPTB_WITH_GMP
+template class cryptb::basic_public_key_cache<boost::multiprecision::mpz_int>;
+#endif
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "rsa.hpp"
+#include "montgomery.hpp"
+#include "sha512.hpp"
+#include <boost/optional.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace cryptb
+{
+	// Remembers the per-key work of verifying signatures (validating the public key
+	// and the Montgomery setup for N) for the most recently used public keys.
+	//
+	// For a service that verifies signatures from a few thousand signers that keep coming back,
+	// the verification of a known key is then a cache lookup plus the exponentiation.
+	//
+	// The keys are found by the SHA-512 of (e, N). The entries are split over "num_shards"
+	// shards that each have their own lock and their own least recently used list,
+	// so that threads verifying signatures of different keys rarely wait for each other.
+	// Thread-safe. The exponentiation itself is done without holding any lock.
+	template <typename int_T>
+	class basic_public_key_cache
+	{
+	public:
+		struct statistics
+		{
+			std::uint64_t num_hits = 0;
+			std::uint64_t num_misses = 0;
+			// Entries that were dropped to make room for new ones
+			std::uint64_t num_evictions = 0;
+			// Number of public keys in the cache right now
+			std::size_t size = 0;
+			std::size_t capacity = 0;
+		};
+
+	private:
+		// Everything that the verification needs to know about one public key
+		struct entry
+		{
+			// basic_rsa::is_valid_public_key(e, N)
+			bool is_valid = false;
+			// Empty when the key isn't valid or when Montgomery isn't used for N
+			montgomery_context<int_T> context;
+		};
+
+		// Shared with the threads that are still using an entry after it was evicted
+		using entry_ptr = std::shared_ptr<const entry>;
+
+		struct digest_hash
+		{
+			std::size_t operator()(const sha512::digest_t& digest) const;
+		};
+
+		struct shard
+		{
+			std::mutex mutex;
+			// Most recently used first
+			std::list<std::pair<sha512::digest_t, entry_ptr>> lru;
+			std::unordered_map<sha512::digest_t, typename std::list<std::pair<sha512::digest_t, entry_ptr>>::iterator, digest_hash> index;
+			std::uint64_t num_hits = 0;
+			std::uint64_t num_misses = 0;
+			std::uint64_t num_evictions = 0;
+		};
+
+		std::vector<std::unique_ptr<shard>> m_shards;
+		std::size_t m_capacity_per_shard = 0;
+
+		static sha512::digest_t key_digest(const int_T& e, const int_T& N);
+		// The entry of (e, N), set up and inserted when it's not in the cache yet.
+		entry_ptr find_or_insert(const int_T& e, const int_T& N);
+
+	public:
+		// Keeps up to "capacity" public keys (rounded up to a multiple of "num_shards").
+		// Throws std::invalid_argument if "capacity" or "num_shards" is 0.
+		explicit basic_public_key_cache(const std::size_t capacity, const std::size_t num_shards = 16);
+		basic_public_key_cache(const basic_public_key_cache&) = delete;
+		basic_public_key_cache& operator=(const basic_public_key_cache&) = delete;
+
+		// Same as basic_rsa::encrypt
+		boost::optional<int_T> encrypt(const int_T& original_message, const int_T& e, const int_T& N);
+
+		// Same as basic_rsa::is_valid_signature
+		bool is_valid_signature(
+			const int_T& message_hash,
+			const int_T& signature_of_hash,
+			const int_T& e,
+			const int_T& N);
+
+		// Totals of all of the shards
+		statistics get_statistics() const;
+
+		// Drops every entry. The counters keep counting.
+		void clear();
+	};
+
+	using public_key_cache = basic_public_key_cache<boost::multiprecision::cpp_int>;
+
+	template <unsigned Bits>
+	using fixed_public_key_cache = basic_public_key_cache<fixed_uint<Bits>>;
+
+	extern template class basic_public_key_cache<boost::multiprecision::cpp_int>;
+	extern template class basic_public_key_cache<fixed_uint<1024>>;
+	extern template class basic_public_key_cache<fixed_uint<2048>>;
+	extern template class basic_public_key_cache<fixed_uint<3072>>;
+	extern template class basic_public_key_cache<fixed_uint<4096>>;
+
+#ifdef CRYPTB_WITH_GMP
+	using gmp_public_key_cache = basic_public_key_cache<boost::multiprecision::mpz_int>;
+
+	extern template class basic_public_key_cache<boost::multiprecision::mpz_int>;
+#endif
+}
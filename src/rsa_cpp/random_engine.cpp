@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <type_traits>
 #include <cstring>
+#include <iterator>
+#include <boost/endian/conversion.hpp>
 
 // For true random number generation (gen_truly_random_bytes)
 #include <random>
@@ -26,7 +28,49 @@ std::array<std::uint8_t, 64> cryptb::random_engine::gen_512_bit_random_number()
 	return result;
 }
 
-boost::multiprecision::cpp_int cryptb::random_engine::operator()(int num_bytes)
+void cryptb::random_engine::fill(std::span<std::uint8_t> output)
+{
+	if (output.empty())
+		return;
+	// The key block is the key followed by a label, which is a different input than
+	// anything that the chain itself ever hashes.
+	static constexpr char counter_mode_label[] = "cryptb::random_engine::fill counter mode";
+	static_assert(64 + sizeof(counter_mode_label) <= 128, "The key block is a single message block");
+	std::array<std::uint8_t, 128> key_block{ {0} };
+	{
+		const std::array<std::uint8_t, 64> key = this->gen_512_bit_random_number();
+		std::copy(key.cbegin(), key.cend(), key_block.begin());
+		std::copy(std::cbegin(counter_mode_label), std::cend(counter_mode_label), key_block.begin() + key.size());
+	}
+	const sha512 keyed{ sha512{ key_block.data(), key_block.size() }.export_midstate().get() };
+	std::uint64_t counter = 0;
+	for (std::size_t index = 0; index < output.size(); ++counter)
+	{
+		std::array<std::uint8_t, 8> counter_bytes{ {0} };
+		boost::endian::store_big_u64(counter_bytes.data(), counter);
+		sha512 block = keyed;
+		block.update(counter_bytes.data(), counter_bytes.size());
+		const sha512::digest_t output_block = block.digest();
+		const std::size_t num_bytes_to_copy = std::min<std::size_t>(output.size() - index, output_block.size());
+		std::copy(output_block.cbegin(), output_block.cbegin() + num_bytes_to_copy, output.begin() + index);
+		index += num_bytes_to_copy;
+	}
+}
+
+cryptb::random_engine cryptb::random_engine::fork()
+{
+	std::array<std::uint8_t, random_engine::optimal_seed_size_bytes> seed_bytes{ {0} };
+	for (int index = 0; index < static_cast<int>(seed_bytes.size()); )
+	{
+		const std::array<std::uint8_t, 64> rand_num = this->gen_512_bit_random_number();
+		const int num_bytes_to_copy = std::min<int>(static_cast<int>(seed_bytes.size()) - index, static_cast<int>(rand_num.size()));
+		std::copy(rand_num.cbegin(), rand_num.cbegin() + num_bytes_to_copy, seed_bytes.begin() + index);
+		index += num_bytes_to_copy;
+	}
+	return random_engine(seed_bytes);
+}
+
+std::vector<std::uint8_t> cryptb::random_engine::gen_bytes(const int num_bytes)
 {
 	if (num_bytes < 0)
 	{
@@ -44,15 +88,7 @@ boost::multiprecision::cpp_int cryptb::random_engine::operator()(int num_bytes)
 		const int num_bytes_to_push = std::min<int>(num_bytes_missing, static_cast<int>(rand_num.size()));
 		rand_num_as_bytes.insert(rand_num_as_bytes.cend(), rand_num.cbegin(), rand_num.cbegin() + num_bytes_to_push);
 	}
-	boost::multiprecision::cpp_int integer_from_bytes;
-	// The "msv_first == true" means that if rand_num_as_bytes
-	// is: { 0x0f, 0xf0, 0x12, 0x30 }
-	// then it'll turn into: 0xff01230
-	// The alternative ("msv_first == true") would make the
-	// outputted boost::multiprecision::cpp_int be: 0x3012f00f
-	// But it doesn't matter that much. As long as it's random.
-	boost::multiprecision::import_bits(integer_from_bytes, rand_num_as_bytes.begin(), rand_num_as_bytes.end(), 8, true);
-	return integer_from_bytes;
+	return rand_num_as_bytes;
 }
 static constexpr int ceil_division(const int dividend, const int divisor)
 {
@@ -8,7 +8,10 @@
 #include <limits>
 #include <algorithm>
 #include <vector>
+#include <span>
+#include <stdexcept>
 #include "sha512.hpp"
+#include "number_traits.hpp"
 
 namespace cryptb
 {
@@ -19,6 +22,10 @@ namespace cryptb
 	class random_engine
 	{
 		sha512 m_state;
+
+		// "num_bytes" bytes straight from the chain, gen_512_bit_random_number after gen_512_bit_random_number.
+		std::vector<std::uint8_t> gen_bytes(const int num_bytes);
+
 	public:
 		// m_state has the following values:
 		//
@@ -98,10 +105,62 @@ namespace cryptb
 		}
 
 		// Get n random number with n number of bytes.
-		boost::multiprecision::cpp_int operator()(int num_bytes);
+		// The result is a "int_T" (see number_traits.hpp), and the same bytes
+		// give the same number whatever the type is.
+		template <typename int_T = boost::multiprecision::cpp_int>
+		int_T operator()(int num_bytes)
+		{
+			const std::vector<std::uint8_t> bytes = this->gen_bytes(num_bytes);
+			return number_from_bytes<int_T>(bytes.data(), bytes.data() + bytes.size());
+		}
+
+		// Fills "output" with pseudo random bytes, in counter mode:
+		// one step of the chain (gen_512_bit_random_number) gives a 512-bit key,
+		// and then output block number i is SHA-512(key block || i).
+		// The key block is hashed once (see sha512::export_midstate) so every 64 bytes
+		// of output cost a single compression, instead of the two whole digests
+		// that gen_512_bit_random_number costs.
+		// The chain only moves one step per call, however big "output" is.
+		void fill(std::span<std::uint8_t> output);
+
+		// Sets "result" to a random number in the range [0, 2 ^ num_bits)
+		// by filling its limbs directly with "fill".
+		// There's no heap allocation when "result" already has room for "num_bits"
+		// (always the case with fixed width numbers that are wide enough).
+		// Throws std::invalid_argument if a fixed width "result" is narrower than "num_bits".
+		template <unsigned MinBits, unsigned MaxBits, boost::multiprecision::cpp_integer_type SignType, boost::multiprecision::cpp_int_check_type Checked, class Allocator>
+		void generate_into(boost::multiprecision::number<boost::multiprecision::cpp_int_backend<MinBits, MaxBits, SignType, Checked, Allocator>>& result, const unsigned num_bits)
+		{
+			using limb_t = boost::multiprecision::limb_type;
+			constexpr unsigned bits_per_limb = sizeof(limb_t) * 8;
+			// Also makes it positive, without giving up the memory that it already has.
+			result = 0;
+			if (num_bits == 0)
+				return;
+			const unsigned num_limbs = (num_bits + bits_per_limb - 1) / bits_per_limb;
+			auto& backend = result.backend();
+			backend.resize(num_limbs, num_limbs);
+			if (backend.size() < num_limbs)
+			{
+				result = 0;
+				throw std::invalid_argument("Error in function \"random_engine::generate_into\"."
+					" \"result\" is too narrow for \"num_bits\".");
+			}
+			limb_t* const limbs = backend.limbs();
+			this->fill(std::span<std::uint8_t>(reinterpret_cast<std::uint8_t*>(limbs), num_limbs * sizeof(limb_t)));
+			const unsigned num_bits_in_top_limb = num_bits % bits_per_limb;
+			if (num_bits_in_top_limb != 0)
+				limbs[num_limbs - 1] &= (static_cast<limb_t>(1) << num_bits_in_top_limb) - 1;
+			// The top limbs might have come out as zero
+			backend.normalize();
+		}
 		// Pseudo random number
 		std::array<std::uint8_t, 64> gen_512_bit_random_number();
 		// Truly random number
 		std::array<std::uint8_t, random_engine::optimal_seed_size_bytes> gen_truly_random_bytes();
+		// A new random_engine seeded deterministically from this one's output.
+		// The two engines' outputs are independent from then on.
+		// random_engine isn't thread-safe, so this is how each thread gets its own.
+		random_engine fork();
 	};
 }
@@ -1,10 +1,18 @@
 #include "rsa.hpp"
 #include "prime.hpp"
+#include "modinv.hpp"
 #include <vector>
 #include <cstddef>
 #include <utility>
+#include <limits>
+#include <future>
+#include <thread>
+#include <algorithm>
+#include <chrono>
 
-cryptb::rsa::rsa(random_engine& rand, const int num_bytes_in_prime_number)
+template <typename int_T>
+cryptb::basic_rsa<int_T>::basic_rsa(random_engine& rand, const int num_bytes_in_prime_number, const int num_threads, const int num_primes, keygen_stats* const stats,
+	const std::atomic<bool>* const stop_requested)
 {
 	if (num_bytes_in_prime_number < 2)
 		throw std::invalid_argument("Error in function \"cryptb::rsa::rsa\"."
@@ -14,64 +22,186 @@ cryptb::rsa::rsa(random_engine& rand, const int num_bytes_in_prime_number)
 			" numbers must be at least 256 which is already more than one byte."
 			" Therefore specifying \"num_bytes_in_prime_number\" == 1 would cause"
 			" an infinite loop.");
+	if (num_primes < 2 || num_primes > basic_rsa::max_num_primes)
+		throw std::invalid_argument("Error in function \"cryptb::rsa::rsa\"."
+			" The argument \"num_primes\" must be between 2 and \"max_num_primes\".");
+	// N always has exactly this many bits
+	const long long num_bits_in_N = static_cast<long long>(num_bytes_in_prime_number) * num_primes * 8;
+	if (std::numeric_limits<int_T>::is_bounded
+		&& num_bits_in_N > std::numeric_limits<int_T>::digits)
+		throw std::invalid_argument("Error in function \"cryptb::rsa::rsa\"."
+			" The argument \"num_bytes_in_prime_number\" is too large for the fixed-width integer type."
+			" N (which has \"num_primes\" times as many bytes as each prime number) wouldn\'t fit.");
+	if (num_threads < 0)
+		throw std::invalid_argument("Error in function \"cryptb::rsa::rsa\"."
+			" The argument \"num_threads\" can\'t be negative.");
+	const int total_threads = num_threads == 0
+		? std::max<int>(1, static_cast<int>(std::thread::hardware_concurrency()))
+		: num_threads;
+	// Only read the clock when somebody wants to know
+	using clock = std::chrono::steady_clock;
+	clock::time_point phase_start;
+	auto end_phase = [stats, &phase_start](std::uint64_t keygen_stats::* const nanoseconds) -> void
+	{
+		if (stats == nullptr)
+			return;
+		const clock::time_point now = clock::now();
+		stats->*nanoseconds += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start).count());
+		phase_start = now;
+	};
+	if (stats != nullptr)
+	{
+		phase_start = clock::now();
+		++stats->num_keys;
+	}
+	// Key generation is a one-time cost so it's done with arbitrary precision
+	// numbers (see keygen_int_t). The results are converted to "int_T" at the end.
+	//
 	// 65537 is the largest known Fermat prime
 	// It's pretty much the standard when choosing e in RSA
-	this->e = 65537;
-	boost::multiprecision::cpp_int PhiN = 0;
+	const keygen_int_t e = 65537;
+	// primes[0] is p, primes[1] is q and the rest (if any) are the other primes of a multi-prime key.
+	std::vector<keygen_int_t> primes(static_cast<std::size_t>(num_primes));
+	keygen_int_t N = 0;
+	keygen_int_t PhiN = 0;
 	// The probability that this do-while loop will run more
 	// than once is small (not that small).
 	// N must be coprime with 65537 and also PhiN must be coprime with 65537
 	// But if they're not coprime, which is unlikely but does happen,
-	// we'll just generate another p and q until e is coprime with both PhiN and with N.
+	// we'll just generate other primes until e is coprime with both PhiN and with N.
 	// e also must be smaller than PhiN
 	bool is_e_compatible = false;
 	do
 	{
-		auto crypto_rand = [&rand, &num_bytes_in_prime_number]() -> boost::multiprecision::cpp_int
+		auto crypto_rand = [&num_bytes_in_prime_number, stop_requested](random_engine& engine, const int threads, keygen_stats* const prime_stats) -> keygen_int_t
 		{
-			return cryptb::prime::gen_random(num_bytes_in_prime_number, rand);
+			if (stop_requested == nullptr)
+				return cryptb::basic_prime<keygen_int_t>::gen_random_parallel(num_bytes_in_prime_number, engine, threads, prime_stats);
+			boost::optional<keygen_int_t> prime = cryptb::basic_prime<keygen_int_t>::gen_random_parallel(num_bytes_in_prime_number, engine, threads,
+				*stop_requested, prime_stats);
+			if (prime == boost::none)
+				throw operation_cancelled();
+			return std::move(prime.get());
 		};
-		boost::multiprecision::cpp_int p = crypto_rand();
-		boost::multiprecision::cpp_int q = 0;
-		// Not sure this do-while loop is required because it's super unlikely to be needed.
-		do
+		if (total_threads == 1)
+		{
+			for (keygen_int_t& prime : primes)
+			{
+				prime = crypto_rand(rand, 1, stats);
+			}
+		}
+		else
 		{
-			q = crypto_rand();
-		} while (p == q);
-		// N is just the multiple of the two generated secret primes.
+			// Search for the last prime on this thread and for all of the others on other threads,
+			// each one on its share of the threads (the last one gets what's left over).
+			// Each search gets its own engine because random_engine isn't thread-safe.
+			const int threads_per_prime = std::max(1, total_threads / num_primes);
+			const int threads_for_last = std::max(1, total_threads - threads_per_prime * (num_primes - 1));
+			std::vector<random_engine> engines;
+			engines.reserve(primes.size());
+			for (std::size_t index = 0; index < primes.size(); ++index)
+			{
+				engines.push_back(rand.fork());
+			}
+			// The same goes for the statistics (keygen_stats isn't thread-safe either).
+			std::vector<keygen_stats> search_stats(stats != nullptr ? primes.size() : 0);
+			auto stats_of = [&search_stats](const std::size_t index) -> keygen_stats*
+			{
+				return search_stats.empty() ? nullptr : &search_stats[index];
+			};
+			std::vector<std::future<keygen_int_t>> futures;
+			for (std::size_t index = 0; index + 1 < primes.size(); ++index)
+			{
+				futures.push_back(std::async(std::launch::async,
+					[&crypto_rand, &engine = engines[index], threads_per_prime, prime_stats = stats_of(index)]() -> keygen_int_t
+					{
+						return crypto_rand(engine, threads_per_prime, prime_stats);
+					}));
+			}
+			primes.back() = crypto_rand(engines.back(), threads_for_last, stats_of(primes.size() - 1));
+			for (std::size_t index = 0; index < futures.size(); ++index)
+			{
+				primes[index] = futures[index].get();
+			}
+			for (const keygen_stats& current : search_stats)
+			{
+				*stats += current;
+			}
+		}
+		// Not sure this loop is required because it's super unlikely to be needed.
+		for (std::size_t index = 1; index < primes.size(); ++index)
+		{
+			while (std::find(primes.cbegin(), primes.cbegin() + index, primes[index]) != primes.cbegin() + index)
+			{
+				if (stats != nullptr)
+					++stats->num_duplicate_primes;
+				primes[index] = crypto_rand(rand, total_threads, stats);
+			}
+		}
+		// N is just the multiple of the generated secret primes.
 		// Even though N is public, nobody can feasibly find the prime
 		// numbers that were used to generate N because N is such a big number.
-		this->N = p * q;
-		PhiN = (std::move(p) - 1) * (std::move(q) - 1);
+		// Keep the primes (as part of the private key) for CRT based decryption.
+		N = 1;
+		PhiN = 1;
+		for (const keygen_int_t& prime : primes)
+		{
+			N *= prime;
+			PhiN *= prime - 1;
+		}
 		// e must be coprime with PhiN and coprime with N and also smaller than PhiN
 		// gcd = Greatest Common Divisor, uses the Euclidean algorithm.
+		//
+		// The two most significant bits of every prime are set, which is enough for
+		// two primes to always give N all of its bits. The product of three or four primes
+		// can come out a bit or two short, then it's another round too.
 		is_e_compatible =
-			boost::multiprecision::gcd(this->e, N) == 1
-			&& boost::multiprecision::gcd(this->e, PhiN) == 1
-			&& this->e < PhiN;
+			boost::multiprecision::gcd(e, N) == 1
+			&& boost::multiprecision::gcd(e, PhiN) == 1
+			&& e < PhiN
+			&& static_cast<long long>(boost::multiprecision::msb(N)) + 1 == num_bits_in_N;
+		if (!is_e_compatible && stats != nullptr)
+			++stats->num_e_compatibility_retries;
 	} while (!is_e_compatible);
-	this->d = rsa::findd(PhiN, e);
-	if (this->d <= 0)
+	end_phase(&keygen_stats::prime_generation_nanoseconds);
+	// d is the secret decryption key: ((e * d) modulo PhiN) == 1
+	// The loop above made sure that e and PhiN are coprime, so the inverse exists.
+	const boost::optional<keygen_int_t> d = cryptb::modinv(e, PhiN);
+	if (d == boost::none || d.get() <= 0)
 	{
 		throw std::logic_error("Error in function \"cryptb::rsa::rsa\"."
 			" Failed to generate valid RSA public-private key pairs because of an internal logic error."
-			" d is negative or 0."
+			" d doesn\'t exist or is 0."
 			" I recommend to immediately stop using this library because this should never happen."
 			" It should be impossible to reach this exception.");
 	}
+	this->e = static_cast<int_T>(e);
+	this->d = static_cast<int_T>(d.get());
+	this->N = static_cast<int_T>(N);
+	this->p = static_cast<int_T>(primes[0]);
+	this->q = static_cast<int_T>(primes[1]);
+	for (std::size_t index = 2; index < primes.size(); ++index)
+	{
+		other_prime_info other;
+		other.r = static_cast<int_T>(primes[index]);
+		this->other_primes.push_back(std::move(other));
+	}
+	this->compute_crt_components();
+	this->prepare_montgomery();
+	end_phase(&keygen_stats::private_key_nanoseconds);
 	// Test that encryption, decryption and digital signature work with the number a number "num"
-	auto test_num = [this](const boost::multiprecision::cpp_int& num) -> void
+	auto test_num = [this](const int_T& num) -> void
 	{
 		bool passed_test = false;
-		boost::optional<boost::multiprecision::cpp_int> encrypted_message = rsa::encrypt(num, this->e, this->N);
+		boost::optional<int_T> encrypted_message = basic_rsa::encrypt(num, this->e, this->N);
 		if (encrypted_message != boost::none)
 		{
-			boost::optional<boost::multiprecision::cpp_int> decrypted_message = this->decrypt(encrypted_message.get());
+			boost::optional<int_T> decrypted_message = this->decrypt(encrypted_message.get());
 			if (decrypted_message != boost::none)
 			{
 				if (decrypted_message.get() == num)
 				{
-					boost::optional<boost::multiprecision::cpp_int> signature = this->sign(num);
+					boost::optional<int_T> signature = this->sign(num);
 					if (signature != boost::none)
 					{
 						if (this->is_valid_signature(num, signature.get(), this->e, this->N))
@@ -93,119 +223,239 @@ cryptb::rsa::rsa(random_engine& rand, const int num_bytes_in_prime_number)
 	};
 	test_num(5);
 	test_num(this->N - 1);
+	end_phase(&keygen_stats::self_test_nanoseconds);
 }
 
-boost::multiprecision::cpp_int cryptb::rsa::findd(const boost::multiprecision::cpp_int& PhiN, const boost::multiprecision::cpp_int& e)
+template <typename int_T>
+void cryptb::basic_rsa<int_T>::compute_crt_components()
 {
-	if (PhiN < 2 || e < 2)
+	this->dP = this->d % (this->p - 1);
+	this->dQ = this->d % (this->q - 1);
+	// p and q are distinct primes so q is always invertible modulo p.
+	// (Much faster than Fermat's little theorem: powm(q, p - 2, p))
+	const boost::optional<int_T> qInv = cryptb::modinv(this->q, this->p);
+	if (qInv == boost::none)
 	{
-		throw std::invalid_argument("Error in function \"cryptb::rsa::findd\"."
-			" Can\'t use such small values for PhiN or e.");
+		throw std::logic_error("Error in function \"cryptb::rsa::compute_crt_components\"."
+			" q isn\'t invertible modulo p, so p and q aren\'t distinct primes."
+			" It should be impossible to reach this exception.");
 	}
-	// Uses the inverse of the Euclidian algorithm.
-	// A.K.A the extended euclidian algorithm.
-	//
-	// We made sure that PhiN and e are coprime.
-	// 
-	// We want to find d (the secret decryption key) based on PhiN and e.
-	// 
-	// There exist multiple keys d that satisfy the criteria, but they're extremely rare.
-	// The rarity is why the entire RSA algorithm is secure.
-	// 
-	// d must fit the following criteria: ((e * d) modulo PhiN) == 1
-	// Now that we know e and PhiN we must solve for d. That's what this function does.
-	// 
-	// We'll use the extended Euclidean algorithm which computes
-	// exactly what we want.
-	//
-	struct euclid_step
+	this->qInv = qInv.get();
+	// The product of all of the primes before the current one
+	int_T product = this->p * this->q;
+	for (other_prime_info& other : this->other_primes)
 	{
-		boost::multiprecision::cpp_int a = 0, b = 0, quotient = 0;
-	};
-	// Simulating the recursive approach with a std::vector
-	// that stores the results along the way.
-	// After filling the vector we'll then do another loop
-	// that goes through the steps backwards, and deletes element
-	// from the vector along the way. Just like in the recursive approach.
-	std::vector<euclid_step> steps_of_euclid;
-	const bool PhiN_greater_than_e = PhiN > e;
-	boost::multiprecision::cpp_int a = PhiN;
-	boost::multiprecision::cpp_int b = e;
-	boost::multiprecision::cpp_int d = 0;
-	while (true)
-	{
-		// a and b will be positive so no difference between modulo and remainder.
-		boost::multiprecision::cpp_int remainder = a % b;
-		if (remainder == 0)
-			break;
-		euclid_step current_step;
-		// Basically, it's just by order of a pen and pencil calculation from left to right
-		current_step.a = std::move(a);
-		current_step.b = std::move(b);
-		current_step.quotient = current_step.a / current_step.b;
-		steps_of_euclid.push_back(current_step);
-		a = current_step.b;
-		b = std::move(remainder);
-	}
-	if (!steps_of_euclid.empty())
-	{
-		euclid_step first_step = std::move(steps_of_euclid.back());
-		// Pairs of numbers and their multiples
-		std::pair<boost::multiprecision::cpp_int, boost::multiprecision::cpp_int> valueA{ std::move(first_step.a), 1 };
-		std::pair<boost::multiprecision::cpp_int, boost::multiprecision::cpp_int> valueB{ std::move(first_step.b), -std::move(first_step.quotient) };
-		steps_of_euclid.pop_back();
-		for (bool BSmaller = true; !steps_of_euclid.empty(); steps_of_euclid.pop_back())
+		other.d = this->d % (other.r - 1);
+		const boost::optional<int_T> t = cryptb::modinv(static_cast<int_T>(product % other.r), other.r);
+		if (t == boost::none)
 		{
-			euclid_step current_step = std::move(steps_of_euclid.back());
-			if (BSmaller)
-			{
-				BSmaller = false;
-				valueA.second = std::move(valueA.second) + valueB.second * (-std::move(current_step.quotient));
-				valueB.first = std::move(current_step.a);
-			}
-			else
-			{
-				BSmaller = true;
-				valueB.second = std::move(valueB.second) + valueA.second * (-std::move(current_step.quotient));
-				valueA.first = std::move(current_step.a);
-			}
-		}
-		// We could use d >= PhiN but that would be continuously slow so we
-		// might as well use the reduced version: d modulo PhiN because it's the same.
-		if (valueA.first > valueB.first)
-		{
-			d = std::move(valueB.second) % PhiN;
+			throw std::logic_error("Error in function \"cryptb::rsa::compute_crt_components\"."
+				" The primes aren\'t distinct."
+				" It should be impossible to reach this exception.");
 		}
+		other.t = t.get();
+		// Can't overflow because the product of all of the primes is N
+		product *= other.r;
+	}
+}
+
+template <typename int_T>
+void cryptb::basic_rsa<int_T>::prepare_montgomery()
+{
+	auto prepare = [](montgomery_context<int_T>& context, const int_T& modulus) -> void
+	{
+		if (basic_rsa::use_montgomery(modulus))
+			context = montgomery_context<int_T>(modulus);
 		else
+			context = montgomery_context<int_T>();
+	};
+	prepare(this->mont_N, this->N);
+	prepare(this->mont_p, this->p);
+	prepare(this->mont_q, this->q);
+	this->mont_other_primes.resize(this->other_primes.size());
+	for (std::size_t index = 0; index < this->other_primes.size(); ++index)
+	{
+		prepare(this->mont_other_primes[index], this->other_primes[index].r);
+	}
+}
+
+template <typename int_T>
+int_T cryptb::basic_rsa<int_T>::decrypt_crt(const int_T& encrypted_message) const
+{
+	// Two exponentiations with half-size exponents and moduli.
+	// powm cost grows roughly with the cube of the size of the numbers
+	// so each of the two is about 8 times cheaper than powm(c, d, N).
+	const int_T m1 = basic_rsa::powm(this->mont_p, static_cast<int_T>(encrypted_message % this->p), this->dP, this->p);
+	const int_T m2 = basic_rsa::powm(this->mont_q, static_cast<int_T>(encrypted_message % this->q), this->dQ, this->q);
+	// m1 - m2 might be negative, and "int_T" might be unsigned.
+	// Compute (m1 - m2) modulo p without ever going below 0.
+	int_T h = m2 % this->p;
+	if (m1 >= h)
+		h = m1 - h;
+	else
+		h = this->p - h + m1;
+	h = (this->qInv * h) % this->p;
+	// Result is in the range [0, p * q) because m2 < q and h <= p - 1
+	int_T m = m2 + h * this->q;
+	if (this->other_primes.empty())
+		return m;
+	// Multi-prime: add one prime at a time, the same way.
+	// After each step m is the result modulo the product of the primes so far (R * r).
+	int_T R = this->p * this->q;
+	for (std::size_t index = 0; index < this->other_primes.size(); ++index)
+	{
+		const other_prime_info& other = this->other_primes[index];
+		const int_T mi = basic_rsa::powm(this->mont_other_primes[index], static_cast<int_T>(encrypted_message % other.r), other.d, other.r);
+		h = m % other.r;
+		if (mi >= h)
+			h = mi - h;
+		else
+			h = other.r - h + mi;
+		h = (other.t * h) % other.r;
+		m += h * R;
+		// Can't overflow because the product of all of the primes is N
+		R *= other.r;
+	}
+	return m;
+}
+
+template <typename int_T>
+bool cryptb::basic_rsa<int_T>::sign_batch(std::span<const int_T> message_hashes, std::span<int_T> signatures, thread_pool& pool) const
+{
+	if (message_hashes.size() != signatures.size())
+	{
+		throw std::invalid_argument("Error in function \"cryptb::rsa::sign_batch\"."
+			" \"message_hashes\" and \"signatures\" must be the same size.");
+	}
+	// Check everything up front (it's cheap) so that there's never a half-signed batch.
+	for (const int_T& message_hash : message_hashes)
+	{
+		if (message_hash >= this->N || message_hash < 0)
+			return false;
+	}
+	// One task per signature. Each one is milliseconds of work so the
+	// scheduling overhead doesn't matter, and idle threads steal from busy ones.
+	pool.parallel_for(message_hashes.size(), [this, &message_hashes, &signatures](const std::size_t index) -> void
+	{
+		signatures[index] = this->sign(message_hashes[index]).get();
+	});
+	return true;
+}
+
+template <typename int_T>
+bool cryptb::basic_rsa<int_T>::sign_batch(std::span<const int_T> message_hashes, std::span<int_T> signatures, const int num_threads) const
+{
+	thread_pool pool{ num_threads };
+	return this->sign_batch(message_hashes, signatures, pool);
+}
+
+template <typename int_T>
+int_T cryptb::basic_rsa<int_T>::digest_to_number(const sha512::digest_t& digest)
+{
+	return number_from_bytes<int_T>(digest.data(), digest.data() + digest.size());
+}
+
+template <typename int_T>
+boost::optional<int_T> cryptb::basic_rsa<int_T>::sign_file(const std::filesystem::path& path) const
+{
+	return this->sign(basic_rsa::digest_to_number(sha512::hash_file(path)));
+}
+
+template <typename int_T>
+bool cryptb::basic_rsa<int_T>::is_valid_file_signature(
+	const std::filesystem::path& path,
+	const int_T& signature_of_hash,
+	const int_T& e,
+	const int_T& N)
+{
+	return basic_rsa::is_valid_signature(basic_rsa::digest_to_number(sha512::hash_file(path)), signature_of_hash, e, N);
+}
+
+template <typename int_T>
+std::vector<bool> cryptb::basic_rsa<int_T>::is_valid_signature_batch(
+	std::span<const int_T> message_hashes,
+	std::span<const int_T> signatures,
+	std::span<const std::size_t> key_indexes,
+	std::span<const int_T> es,
+	std::span<const int_T> Ns,
+	thread_pool& pool)
+{
+	if (message_hashes.size() != signatures.size() || message_hashes.size() != key_indexes.size() || es.size() != Ns.size())
+	{
+		throw std::invalid_argument("Error in function \"cryptb::rsa::is_valid_signature_batch\"."
+			" \"message_hashes\", \"signatures\" and \"key_indexes\" must be the same size,"
+			" and so must \"es\" and \"Ns\".");
+	}
+	// Counting sort of the signatures by public key.
+	// group_starts[k] is where key k's signatures start inside of "grouped".
+	std::vector<std::size_t> group_starts(es.size() + 1, 0);
+	for (const std::size_t key_index : key_indexes)
+	{
+		if (key_index >= es.size())
 		{
-			d = std::move(valueA.second) % PhiN;
+			throw std::invalid_argument("Error in function \"cryptb::rsa::is_valid_signature_batch\"."
+				" One of the \"key_indexes\" is out of range.");
 		}
-		// We could use a negative d but that would be confusing and slow
-		// so we'll use the equivalent positive d.
-		//
-		// powm functions that take powm(base, exponent, modulo)
-		// tend to have problems with negative exponents.
-		// 
-		// For example in Python3.7:
-		//	pow(2, -3, 5) throws an exception
-		// But in Python3.8
-		//	pow(2, -3, 5) == 2
-		// And yet:
-		//	pow(2, -3, 8) throws an exception even in Python3.8
-		//
-		if (d < 0)
+		++group_starts[key_index + 1];
+	}
+	for (std::size_t key_index = 0; key_index < es.size(); ++key_index)
+	{
+		group_starts[key_index + 1] += group_starts[key_index];
+	}
+	std::vector<std::size_t> grouped(key_indexes.size());
+	{
+		std::vector<std::size_t> next_in_group(group_starts.cbegin(), group_starts.cend() - 1);
+		for (std::size_t index = 0; index < key_indexes.size(); ++index)
 		{
-			// Make d positive
-			d += PhiN;
+			grouped[next_in_group[key_indexes[index]]++] = index;
 		}
 	}
-	else
+	// A key with many signatures is split into chunks so that it doesn't end up
+	// on a single thread. Each chunk repeats the per-key setup, which costs less than a
+	// handful of verifications, so chunks of this size keep the overhead small.
+	constexpr std::size_t max_chunk_size = 64;
+	struct chunk
+	{
+		std::size_t key_index = 0, begin = 0, end = 0;
+	};
+	std::vector<chunk> chunks;
+	for (std::size_t key_index = 0; key_index < es.size(); ++key_index)
 	{
-		// You can't rely on this exception to always be thrown when
-		// the arguments PhiN and d are not coprime.
-		// In this case we just happen to certainly know that something is wrong.
-		throw std::invalid_argument("Error in function \"cryptb::rsa::findd\"."
-			" The given PhiN and e are definitely not coprime. That will produce a completely invalid RSA key pair.");
+		for (std::size_t begin = group_starts[key_index]; begin < group_starts[key_index + 1]; begin += max_chunk_size)
+		{
+			chunks.push_back(chunk{ key_index, begin, std::min(begin + max_chunk_size, group_starts[key_index + 1]) });
+		}
 	}
-	return d;
+	// Not std::vector<bool> because different threads write to neighbouring elements.
+	std::vector<char> results(message_hashes.size(), 0);
+	pool.parallel_for(chunks.size(), [&](const std::size_t chunk_index) -> void
+	{
+		const chunk& current = chunks[chunk_index];
+		const int_T& e = es[current.key_index];
+		const int_T& N = Ns[current.key_index];
+		// Invalid keys leave every one of their results false.
+		if (!basic_rsa::is_valid_public_key(e, N))
+			return;
+		const bool use_montgomery = basic_rsa::use_montgomery(N);
+		const montgomery_context<int_T> context = use_montgomery ? montgomery_context<int_T>(N) : montgomery_context<int_T>();
+		for (std::size_t position = current.begin; position < current.end; ++position)
+		{
+			const std::size_t index = grouped[position];
+			const int_T& signature = signatures[index];
+			if (signature >= N || signature < 0)
+				continue;
+			const int_T decrypted = basic_rsa::powm_public(context, signature, e, N);
+			results[index] = decrypted == message_hashes[index];
+		}
+	});
+	return std::vector<bool>(results.cbegin(), results.cend());
 }
+
+template class cryptb::basic_rsa<boost::multiprecision::cpp_int>;
+template class cryptb::basic_rsa<cryptb::fixed_uint<1024>>;
+template class cryptb::basic_rsa<cryptb::fixed_uint<2048>>;
+template class cryptb::basic_rsa<cryptb::fixed_uint<3072>>;
+template class cryptb::basic_rsa<cryptb::fixed_uint<4096>>;
+#ifdef CRYPTB_WITH_GMP
+template class cryptb::basic_rsa<boost::multiprecision::mpz_int>;
+#endif
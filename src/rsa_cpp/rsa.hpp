@@ -1,67 +1,278 @@
 #pragma once
 
 #include "random_engine.hpp"
+#include "sha512.hpp"
+#include "fixed_uint.hpp"
+#include "montgomery.hpp"
+#include "number_traits.hpp"
+#include "keygen_stats.hpp"
+#include "cancellation.hpp"
+#include "trace.hpp"
+#include "thread_pool.hpp"
 #include <boost/multiprecision/cpp_int.hpp>
 #include <boost/optional.hpp>
+#include <filesystem>
+#include <span>
+#include <vector>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
 
 namespace cryptb
 {
-	class rsa
+	// RSA public-private key pair based on the integer type "int_T".
+	//
+	// "int_T" is either boost::multiprecision::cpp_int (see cryptb::rsa),
+	// a fixed_uint that's wide enough to hold N (see cryptb::fixed_rsa)
+	// or, when built with CRYPTB_WITH_GMP, boost::multiprecision::mpz_int (see cryptb::gmp_rsa).
+	//
+	// With a fixed_uint there are zero heap allocations in encrypt, decrypt, sign
+	// and is_valid_signature. Key generation still uses cpp_int internally.
+	//
+	// Only the instantiations declared with "extern template" at the bottom of this file
+	// are compiled into the library.
+	template <typename int_T>
+	class basic_rsa
 	{
+	public:
+		// The CRT components of the third, fourth, ... prime factor of a multi-prime key.
+		// Same as OtherPrimeInfo in PKCS #1.
+		struct other_prime_info
+		{
+			// The prime factor
+			int_T r{ 0 };
+			// d modulo (r - 1)
+			int_T d{ 0 };
+			// The modular inverse of the product of all of the previous primes (p * q * ...) modulo r
+			int_T t{ 0 };
+		};
+
+		// Largest supported number of prime factors of N
+		static constexpr int max_num_primes = 4;
+
+	private:
+		// Reuses use_montgomery and powm_public
+		template <typename> friend class basic_public_key_cache;
+
 		// Private key- for decrypting / digital signing
 		// DON'T SHARE d WITH THE CLIENT!
 		// Tends to be a number with around 2048 bits.
-		boost::multiprecision::cpp_int d{ 0 };
+		int_T d{ 0 };
 
 		// It's completely safe to share e and N with the entire world.
 		// In fact, you should.
 
 		// Public key- for encrypting / verifying digital signature
 		// Tends to be a very small number. Choosing the number 3 for example, is common.
-		boost::multiprecision::cpp_int e{ 0 };
+		int_T e{ 0 };
 
 		// Public key- for everything. N is needed for all operations.
 		// Tends to be a number with about 4096 bits.
-		boost::multiprecision::cpp_int N{ 0 };
+		int_T N{ 0 };
+
+		// Chinese remainder theorem (CRT) components of the private key.
+		// DON'T SHARE ANY OF THESE WITH THE CLIENT! Knowing p or q is the same as knowing d.
+		//
+		// They let decrypt / sign do two exponentiations with half-size numbers
+		// (modulo p and modulo q) instead of one exponentiation modulo N.
+		// That's about 3 to 4 times faster.
+		//
+		// When p == 0 the CRT components are unknown (the key was loaded from (e, d, N) only)
+		// and decrypt / sign fall back to powm(message, d, N).
+		int_T p{ 0 };
+		int_T q{ 0 };
+		// d modulo (p - 1)
+		int_T dP{ 0 };
+		// d modulo (q - 1)
+		int_T dQ{ 0 };
+		// The modular inverse of q modulo p: ((q * qInv) modulo p) == 1
+		int_T qInv{ 0 };
+		// Empty unless N has more than two prime factors (multi-prime RSA).
+		// Every extra prime makes each exponentiation smaller again.
+		std::vector<other_prime_info> other_primes;
+
+		// Montgomery precomputation for N, p and q.
+		// Set up once per key so that every decrypt / sign only pays for the exponentiation.
+		// Empty when the matching modulus is unknown (or even), and always empty with GMP.
+		montgomery_context<int_T> mont_N;
+		montgomery_context<int_T> mont_p;
+		montgomery_context<int_T> mont_q;
+		// Same index as "other_primes"
+		std::vector<montgomery_context<int_T>> mont_other_primes;
 
-		// A pure mathematical function to solve for d such that:
-		// ((e * d) modulo PhiN) == 1
-		// e and PhiN must already be coprime.
-		static boost::multiprecision::cpp_int findd(const boost::multiprecision::cpp_int& PhiN, const boost::multiprecision::cpp_int& e);
+		// Key generation needs numbers that are larger than N (and negative ones),
+		// so fixed-width types generate the key with cpp_int and convert it at the end.
+		using keygen_int_t = typename std::conditional<std::numeric_limits<int_T>::is_bounded,
+			boost::multiprecision::cpp_int, int_T>::type;
+
+		// Whether to use a montgomery_context for "modulus" instead of boost::multiprecision::powm.
+		// Not with GMP, its own powm is faster.
+		static bool use_montgomery(const int_T& modulus)
+		{
+			return is_cpp_int_number<int_T>::value && montgomery_context<int_T>::is_supported_modulus(modulus);
+		}
+
+		// Fills in dP, dQ and qInv based on d, p and q,
+		// and the d and t of every one of "other_primes" based on their r.
+		void compute_crt_components();
+
+		// Fills in mont_N, mont_p, mont_q and mont_other_primes.
+		void prepare_montgomery();
+
+		// powm(base, exponent, context.get_modulus()) when the context isn't empty,
+		// otherwise falls back to boost::multiprecision::powm(base, exponent, modulus).
+		static int_T powm(const montgomery_context<int_T>& context, const int_T& base, const int_T& exponent, const int_T& modulus)
+		{
+			CRYPTB_TRACE_SCOPE(trace::event::rsa_powm_private);
+			if (context.empty())
+				return static_cast<int_T>(boost::multiprecision::powm(base, exponent, modulus));
+			return context.powm(base, exponent);
+		}
+
+		// powm(message, e, N), specialized for e == 65537 (the e of every key that this library generates)
+		// when "context" (for N) isn't empty, otherwise boost::multiprecision::powm.
+		static int_T powm_public(const montgomery_context<int_T>& context, const int_T& message, const int_T& e, const int_T& N)
+		{
+			CRYPTB_TRACE_SCOPE(trace::event::rsa_powm_public);
+			if (context.empty())
+				return static_cast<int_T>(boost::multiprecision::powm(message, e, N));
+			if (e == 65537)
+				return context.powm_65537(message);
+			return context.powm(message, e);
+		}
+
+		// Garner's recombination:
+		// m1 = powm(c, dP, p)
+		// m2 = powm(c, dQ, q)
+		// h = (qInv * (m1 - m2)) modulo p
+		// m = m2 + h * q
+		// and then for every one of "other_primes" (R is the product of all of the previous primes):
+		// mi = powm(c, di, ri)
+		// h = (ti * (mi - m)) modulo ri
+		// m = m + h * R
+		// Requires the CRT components to be known (p != 0).
+		int_T decrypt_crt(const int_T& encrypted_message) const;
 
 	public:
-		rsa(const rsa&) = default;
-		rsa(rsa&&) = default;
-		rsa& operator=(const rsa&) = default;
-		rsa& operator=(rsa&&) = default;
+		basic_rsa(const basic_rsa&) = default;
+		basic_rsa(basic_rsa&&) = default;
+		basic_rsa& operator=(const basic_rsa&) = default;
+		basic_rsa& operator=(basic_rsa&&) = default;
 
 		// Constructor for generating RSA public-private key pair using the given random engine.
 		//
 		// When "num_bytes_in_prime_number" == 128 that's 2048-bit RSA
-		// Should take a second and a half (very expensive function, call on an asynchronous thread).
+		// Should take a second and a half (very expensive function, call on an asynchronous thread, see cryptb::async).
 		// 
 		// "num_bytes_in_prime_number" must be at least 2
+		// When "int_T" is a fixed_uint, N ("num_primes" * "num_bytes_in_prime_number" bytes) must fit in it.
+		//
+		// "num_primes" > 2 makes a multi-prime key (up to "max_num_primes"):
+		// N is the product of "num_primes" primes of "num_bytes_in_prime_number" bytes each,
+		// so 4096-bit RSA with 4 primes is "num_bytes_in_prime_number" == 128 and "num_primes" == 4.
+		// Smaller primes are much faster to find and make decrypt / sign faster too.
+		// The public key (e, N) is a normal RSA public key, nothing changes for encrypt / is_valid_signature.
+		//
+		// "num_threads" > 1 searches for p and q at the same time, each one on
+		// half of the threads (see prime::gen_random_parallel).
+		// "num_threads" == 0 uses std::thread::hardware_concurrency() threads.
+		// With more than one thread the generated key depends on thread timing,
+		// not only on the state of "rand".
+		//
+		// When "stats" isn't nullptr, where the time went (candidates, Miller-Rabin tests,
+		// retries, time of each phase) is added to it. See keygen_stats.
+		//
+		// When "stop_requested" isn't nullptr, the prime searches give up as soon as it's set
+		// (by another thread) and operation_cancelled is thrown. See cryptb::async::generate_key.
 		//
-		rsa(random_engine& rand, const int num_bytes_in_prime_number = 128);
+		basic_rsa(random_engine& rand, const int num_bytes_in_prime_number = 128, const int num_threads = 1, const int num_primes = 2, keygen_stats* const stats = nullptr,
+			const std::atomic<bool>* const stop_requested = nullptr);
 
 		// Constructor for loading RSA public-private key pairs from values
-		rsa(boost::multiprecision::cpp_int&& e, boost::multiprecision::cpp_int&& d, boost::multiprecision::cpp_int&& N) :
-			e(std::move(e)), d(std::move(d)), N(std::move(N)) {}
+		basic_rsa(int_T&& e, int_T&& d, int_T&& N) :
+			d(std::move(d)), e(std::move(e)), N(std::move(N))
+		{
+			this->prepare_montgomery();
+		}
+
+		// Constructor for loading RSA public-private key pairs from values
+		// including the CRT components (the same ones as in PKCS #1).
+		// Much faster decrypt / sign than the (e, d, N) constructor.
+		// When "int_T" is a fixed_uint, p and q must each fit in half of its bits
+		// (which is always the case for keys generated by this library).
+		basic_rsa(int_T&& e, int_T&& d, int_T&& N,
+			int_T&& p, int_T&& q,
+			int_T&& dP, int_T&& dQ, int_T&& qInv) :
+			d(std::move(d)), e(std::move(e)), N(std::move(N)),
+			p(std::move(p)), q(std::move(q)), dP(std::move(dP)), dQ(std::move(dQ)), qInv(std::move(qInv))
+		{
+			this->prepare_montgomery();
+		}
+
+		// Constructor for loading multi-prime RSA public-private key pairs from values
+		// including the CRT components of all of the prime factors (the same ones as in PKCS #1).
+		// p and q are the first two prime factors and "other_primes" has the rest, in order.
+		basic_rsa(int_T&& e, int_T&& d, int_T&& N,
+			int_T&& p, int_T&& q,
+			int_T&& dP, int_T&& dQ, int_T&& qInv,
+			std::vector<other_prime_info>&& other_primes) :
+			d(std::move(d)), e(std::move(e)), N(std::move(N)),
+			p(std::move(p)), q(std::move(q)), dP(std::move(dP)), dQ(std::move(dQ)), qInv(std::move(qInv)),
+			other_primes(std::move(other_primes))
+		{
+			this->prepare_montgomery();
+		}
 
 		// Private secret key, don't share.
-		const boost::multiprecision::cpp_int& get_d() const
+		const int_T& get_d() const
 		{
 			return this->d;
 		}
 
+		// Private secret CRT components, don't share.
+		// All of them are 0 when the key was loaded without them.
+		const int_T& get_p() const
+		{
+			return this->p;
+		}
+		const int_T& get_q() const
+		{
+			return this->q;
+		}
+		const int_T& get_dP() const
+		{
+			return this->dP;
+		}
+		const int_T& get_dQ() const
+		{
+			return this->dQ;
+		}
+		const int_T& get_qInv() const
+		{
+			return this->qInv;
+		}
+		// Empty unless the key has more than two prime factors.
+		const std::vector<other_prime_info>& get_other_primes() const
+		{
+			return this->other_primes;
+		}
+
+		// Number of known prime factors of N: 0 when the key was loaded without them, otherwise 2 or more.
+		int get_num_primes() const
+		{
+			if (this->p == 0)
+				return 0;
+			return 2 + static_cast<int>(this->other_primes.size());
+		}
+
 		// Public key, no danger. Allowed to reveal to the entire world.
-		const boost::multiprecision::cpp_int& get_e() const
+		const int_T& get_e() const
 		{
 			return this->e;
 		}
 
 		// Public key, no danger. Allowed to reveal to the entire world.
-		const boost::multiprecision::cpp_int& get_N() const
+		const int_T& get_N() const
 		{
 			return this->N;
 		}
@@ -71,8 +282,8 @@ namespace cryptb
 		// computation time down from millions of years to mere microseconds.
 		//
 		// Technically powm treats negative exponents differently than power(a, b)
-		// but in the function "rsa::findd()" we made sure that the returned
-		// d is positive so in our use case we're only dealing with positive numbers.
+		// but "cryptb::modinv()" (which computes d) always returns a
+		// positive d so in our use case we're only dealing with positive numbers.
 		//
 
 		// "original_message" should either be a large random number
@@ -89,24 +300,28 @@ namespace cryptb
 		// and that:
 		// is_valid_public_key(e, N) == true
 		// Otherwise the function will return boost::none
-		static boost::optional<boost::multiprecision::cpp_int> encrypt(
-			const boost::multiprecision::cpp_int& original_message,
-			const boost::multiprecision::cpp_int& e,
-			const boost::multiprecision::cpp_int& N)
+		static boost::optional<int_T> encrypt(
+			const int_T& original_message,
+			const int_T& e,
+			const int_T& N)
 		{
-			if (!rsa::is_valid_public_key(e, N) || original_message >= N || original_message < 0)
+			if (!basic_rsa::is_valid_public_key(e, N) || original_message >= N || original_message < 0)
 				return boost::none;
-			return static_cast<boost::multiprecision::cpp_int>(boost::multiprecision::powm(original_message, e, N));
+			// One-off Montgomery setup for this N. It's cheap compared to the exponentiation.
+			const montgomery_context<int_T> context = basic_rsa::use_montgomery(N) ? montgomery_context<int_T>(N) : montgomery_context<int_T>();
+			return basic_rsa::powm_public(context, original_message, e, N);
 		}
 
 		// You should check that:
 		// 0 <= "encrypted_message" < this->N
 		// Otherwise the function will return boost::none
-		boost::optional<boost::multiprecision::cpp_int> decrypt(const boost::multiprecision::cpp_int& encrypted_message)
+		boost::optional<int_T> decrypt(const int_T& encrypted_message) const
 		{
 			if (encrypted_message >= this->N || encrypted_message < 0)
 				return boost::none;
-			return static_cast<boost::multiprecision::cpp_int>(boost::multiprecision::powm(encrypted_message, this->d, this->N));
+			if (this->p != 0)
+				return this->decrypt_crt(encrypted_message);
+			return basic_rsa::powm(this->mont_N, encrypted_message, this->d, this->N);
 		}
 
 		// RSA digital signature.
@@ -117,40 +332,113 @@ namespace cryptb
 		// You should check that:
 		// 0 <= "message_hash" < this->N
 		// Otherwise the function will return boost::none
-		boost::optional<boost::multiprecision::cpp_int> sign(const boost::multiprecision::cpp_int& message_hash)
+		boost::optional<int_T> sign(const int_T& message_hash) const
 		{
 			// It's the same algorithm. Isn't that convenient!
 			return this->decrypt(message_hash);
 		}
 
+		// Signs every hash in "message_hashes" into the same index of "signatures",
+		// spreading the work over the threads of "pool".
+		// The key is only read, so any number of threads can share one rsa object.
+		//
+		// "message_hashes" and "signatures" must be the same size.
+		// Returns false (without signing anything) if any of the hashes
+		// is out of the range [0, N), just like "sign" would return boost::none.
+		bool sign_batch(std::span<const int_T> message_hashes, std::span<int_T> signatures, thread_pool& pool) const;
+
+		// Same as the function above with a temporary pool of "num_threads" threads.
+		// "num_threads" == 0 uses std::thread::hardware_concurrency() threads.
+		// Prefer reusing a thread_pool when signing many batches.
+		bool sign_batch(std::span<const int_T> message_hashes, std::span<int_T> signatures, const int num_threads = 0) const;
+
 		// Verify an RSA digital signature.
 		static bool is_valid_signature(
-			const boost::multiprecision::cpp_int& message_hash,
-			const boost::multiprecision::cpp_int& signature_of_hash,
-			const boost::multiprecision::cpp_int& e,
-			const boost::multiprecision::cpp_int& N)
+			const int_T& message_hash,
+			const int_T& signature_of_hash,
+			const int_T& e,
+			const int_T& N)
 		{
 			// It's the same algorithm. Isn't that convenient!
-			const boost::optional<boost::multiprecision::cpp_int> result = rsa::encrypt(signature_of_hash, e, N);
+			const boost::optional<int_T> result = basic_rsa::encrypt(signature_of_hash, e, N);
 			if (result == boost::none)
 				return false;
 			// If the signature matches then it's legit.
 			return result.get() == message_hash;
 		}
 
+		// A SHA-512 digest as a number (the first byte is the most significant),
+		// which is what "sign" and "is_valid_signature" expect as "message_hash".
+		static int_T digest_to_number(const sha512::digest_t& digest);
+
+		// Signs the SHA-512 hash of the contents of a file (see sha512::hash_file).
+		// Returns boost::none if the hash isn't smaller than N,
+		// which can only happen with a key of 512 bits or less.
+		// Throws std::runtime_error if the file can't be read.
+		boost::optional<int_T> sign_file(const std::filesystem::path& path) const;
+
+		// Verifies a signature that was made with "sign_file".
+		// Throws std::runtime_error if the file can't be read.
+		static bool is_valid_file_signature(
+			const std::filesystem::path& path,
+			const int_T& signature_of_hash,
+			const int_T& e,
+			const int_T& N);
+
+		// Verifies many signatures against a few public keys.
+		//
+		// Signature number i is "signatures[i]" of "message_hashes[i]" and belongs
+		// to the public key (es[key_indexes[i]], Ns[key_indexes[i]]).
+		// Returns a vector where element i is what is_valid_signature would return for signature number i.
+		//
+		// The signatures are grouped by public key so that the per-key work
+		// (validating the key and the Montgomery setup) is done once per group
+		// instead of once per signature. The groups run in parallel on "pool".
+		static std::vector<bool> is_valid_signature_batch(
+			std::span<const int_T> message_hashes,
+			std::span<const int_T> signatures,
+			std::span<const std::size_t> key_indexes,
+			std::span<const int_T> es,
+			std::span<const int_T> Ns,
+			thread_pool& pool);
+
 		// Recommended to check the validity of public keys taken
 		// from an untrusted source.
 		// We wouldn't want to store an invalid public key
 		// in the database of known public keys.
-		// That would cause functions such as rsa::encrypt
+		// That would cause functions such as basic_rsa::encrypt
 		// to return boost::none
 		static bool is_valid_public_key(
-			const boost::multiprecision::cpp_int& e,
-			const boost::multiprecision::cpp_int& N)
+			const int_T& e,
+			const int_T& N)
 		{
 			if (e < 2 || N < (2*3))
 				return false;
 			return true;
 		}
 	};
+
+	// Arbitrary precision RSA. Supports any key size.
+	using rsa = basic_rsa<boost::multiprecision::cpp_int>;
+
+	// Fixed-width RSA where "Bits" is the size of N.
+	// Supported: 1024, 2048, 3072 and 4096
+	template <unsigned Bits>
+	using fixed_rsa = basic_rsa<fixed_uint<Bits>>;
+
+	using rsa2048 = fixed_rsa<2048>;
+	using rsa4096 = fixed_rsa<4096>;
+
+	extern template class basic_rsa<boost::multiprecision::cpp_int>;
+	extern template class basic_rsa<fixed_uint<1024>>;
+	extern template class basic_rsa<fixed_uint<2048>>;
+	extern template class basic_rsa<fixed_uint<3072>>;
+	extern template class basic_rsa<fixed_uint<4096>>;
+
+#ifdef CRYPTB_WITH_GMP
+	// RSA with GMP numbers, arbitrary precision like cryptb::rsa.
+	using gmp_rsa = basic_rsa<boost::multiprecision::mpz_int>;
+
+	extern template class basic_rsa<boost::multiprecision::mpz_int>;
+#endif
 }
@@ -0,0 +1,231 @@
+#include "rsa_key_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+template <typename int_T>
+cryptb::basic_rsa_key_pool<int_T>::basic_rsa_key_pool(random_engine& rand, const std::vector<int>& num_bytes_in_prime_numbers, const std::size_t capacity, const int num_threads)
+	: m_capacity(capacity)
+{
+	if (capacity == 0 || num_threads <= 0 || num_bytes_in_prime_numbers.empty())
+	{
+		throw std::invalid_argument("Error in function \"cryptb::rsa_key_pool::rsa_key_pool\"."
+			" \"capacity\", \"num_threads\" and the number of key sizes must all be positive.");
+	}
+	this->m_sizes.resize(num_bytes_in_prime_numbers.size());
+	for (std::size_t index = 0; index < num_bytes_in_prime_numbers.size(); ++index)
+	{
+		const int num_bytes_in_prime_number = num_bytes_in_prime_numbers[index];
+		// Same checks as the basic_rsa constructor. Better to throw here than on a background thread.
+		if (num_bytes_in_prime_number < 2
+			|| (std::numeric_limits<int_T>::is_bounded
+				&& static_cast<long long>(num_bytes_in_prime_number) * 2 * 8 > std::numeric_limits<int_T>::digits))
+		{
+			throw std::invalid_argument("Error in function \"cryptb::rsa_key_pool::rsa_key_pool\"."
+				" One of the key sizes can\'t be generated (see the basic_rsa constructor).");
+		}
+		if (std::count(num_bytes_in_prime_numbers.cbegin(), num_bytes_in_prime_numbers.cend(), num_bytes_in_prime_number) != 1)
+		{
+			throw std::invalid_argument("Error in function \"cryptb::rsa_key_pool::rsa_key_pool\"."
+				" The same key size was requested more than once.");
+		}
+		this->m_sizes[index].num_bytes_in_prime_number = num_bytes_in_prime_number;
+		this->m_sizes[index].stats.capacity = capacity;
+		this->m_sizes[index].stats.low_water_mark = capacity;
+	}
+	this->m_threads.reserve(num_threads);
+	for (int index = 0; index < num_threads; ++index)
+	{
+		this->m_threads.emplace_back(&basic_rsa_key_pool::refill_loop, this, rand.fork());
+	}
+}
+
+template <typename int_T>
+cryptb::basic_rsa_key_pool<int_T>::~basic_rsa_key_pool()
+{
+	{
+		const std::lock_guard<std::mutex> lock{ this->m_mutex };
+		this->m_stopping = true;
+	}
+	this->m_stop_requested.store(true, std::memory_order_relaxed);
+	this->m_room_available.notify_all();
+	for (std::thread& thread : this->m_threads)
+	{
+		thread.join();
+	}
+}
+
+template <typename int_T>
+typename cryptb::basic_rsa_key_pool<int_T>::key_size_state& cryptb::basic_rsa_key_pool<int_T>::find_size(const int num_bytes_in_prime_number)
+{
+	const basic_rsa_key_pool& const_this = *this;
+	return const_cast<key_size_state&>(const_this.find_size(num_bytes_in_prime_number));
+}
+
+template <typename int_T>
+const typename cryptb::basic_rsa_key_pool<int_T>::key_size_state& cryptb::basic_rsa_key_pool<int_T>::find_size(const int num_bytes_in_prime_number) const
+{
+	// Linear search is fine, there are only ever a few key sizes.
+	for (const key_size_state& state : this->m_sizes)
+	{
+		if (state.num_bytes_in_prime_number == num_bytes_in_prime_number)
+			return state;
+	}
+	throw std::invalid_argument("Error in function \"cryptb::rsa_key_pool::find_size\"."
+		" The pool doesn\'t keep keys of the requested size.");
+}
+
+// Must be called with m_mutex locked and with at least one key ready.
+template <typename int_T>
+cryptb::basic_rsa<int_T> cryptb::basic_rsa_key_pool<int_T>::take_front(key_size_state& state)
+{
+	basic_rsa<int_T> key = std::move(state.ready.front());
+	state.ready.pop_front();
+	++state.stats.num_acquired;
+	state.stats.low_water_mark = std::min(state.stats.low_water_mark, state.ready.size());
+	this->m_room_available.notify_one();
+	return key;
+}
+
+// Must be called with m_mutex locked and with "state".error set.
+template <typename int_T>
+void cryptb::basic_rsa_key_pool<int_T>::rethrow_error(key_size_state& state)
+{
+	const std::exception_ptr error = std::move(state.error);
+	state.error = nullptr;
+	// The background threads can refill this size again.
+	this->m_room_available.notify_all();
+	std::rethrow_exception(error);
+}
+
+template <typename int_T>
+void cryptb::basic_rsa_key_pool<int_T>::refill_loop(random_engine engine)
+{
+	std::unique_lock<std::mutex> lock{ this->m_mutex };
+	while (true)
+	{
+		key_size_state* emptiest = nullptr;
+		this->m_room_available.wait(lock, [this, &emptiest]() -> bool
+		{
+			emptiest = nullptr;
+			if (this->m_stopping)
+				return true;
+			// Counting the keys that other threads are already generating,
+			// otherwise all of the threads would top up the same key size.
+			for (key_size_state& state : this->m_sizes)
+			{
+				// Waits for somebody to see the error first, a failure that keeps repeating
+				// (like std::bad_alloc) shouldn't keep the thread spinning.
+				if (state.error)
+					continue;
+				const std::size_t num_promised = state.ready.size() + state.num_in_progress;
+				if (num_promised >= this->m_capacity)
+					continue;
+				if (emptiest == nullptr || num_promised < emptiest->ready.size() + emptiest->num_in_progress)
+					emptiest = &state;
+			}
+			return emptiest != nullptr;
+		});
+		if (this->m_stopping)
+			return;
+		++emptiest->num_in_progress;
+		const int num_bytes_in_prime_number = emptiest->num_bytes_in_prime_number;
+		lock.unlock();
+
+		// The expensive part, without holding the lock.
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		keygen_stats key_stats;
+		boost::optional<basic_rsa<int_T>> key;
+		std::exception_ptr error;
+		bool is_cancelled = false;
+		try
+		{
+			key.emplace(engine, num_bytes_in_prime_number, 1, 2, &key_stats, &this->m_stop_requested);
+		}
+		catch (const operation_cancelled&)
+		{
+			// The pool is being destroyed, that's not a failure.
+			is_cancelled = true;
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+		const std::chrono::steady_clock::duration duration = std::chrono::steady_clock::now() - start;
+
+		lock.lock();
+		--emptiest->num_in_progress;
+		// m_stopping is already set, the wait at the top of the loop returns right away.
+		if (is_cancelled)
+			continue;
+		if (error)
+		{
+			++emptiest->stats.num_failed;
+			emptiest->error = error;
+			// Wakes up the acquire calls that are waiting for this size so that they rethrow it.
+			this->m_key_available.notify_all();
+			continue;
+		}
+		emptiest->ready.push_back(std::move(key.get()));
+		++emptiest->stats.num_generated;
+		emptiest->stats.generation_nanoseconds += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+		emptiest->stats.keygen += key_stats;
+		this->m_key_available.notify_all();
+	}
+}
+
+template <typename int_T>
+cryptb::basic_rsa<int_T> cryptb::basic_rsa_key_pool<int_T>::acquire(const int num_bytes_in_prime_number)
+{
+	std::unique_lock<std::mutex> lock{ this->m_mutex };
+	key_size_state& state = this->find_size(num_bytes_in_prime_number);
+	if (state.ready.empty())
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		this->m_key_available.wait(lock, [&state]() -> bool
+		{
+			return !state.ready.empty() || state.error;
+		});
+		const std::uint64_t waited = static_cast<std::uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		++state.stats.num_waited;
+		state.stats.total_wait_nanoseconds += waited;
+		state.stats.max_wait_nanoseconds = std::max(state.stats.max_wait_nanoseconds, waited);
+		if (state.ready.empty())
+			this->rethrow_error(state);
+	}
+	return this->take_front(state);
+}
+
+template <typename int_T>
+boost::optional<cryptb::basic_rsa<int_T>> cryptb::basic_rsa_key_pool<int_T>::try_acquire(const int num_bytes_in_prime_number)
+{
+	const std::lock_guard<std::mutex> lock{ this->m_mutex };
+	key_size_state& state = this->find_size(num_bytes_in_prime_number);
+	if (state.ready.empty() && state.error)
+		this->rethrow_error(state);
+	if (state.ready.empty())
+		return boost::none;
+	return this->take_front(state);
+}
+
+template <typename int_T>
+typename cryptb::basic_rsa_key_pool<int_T>::statistics cryptb::basic_rsa_key_pool<int_T>::get_statistics(const int num_bytes_in_prime_number) const
+{
+	const std::lock_guard<std::mutex> lock{ this->m_mutex };
+	const key_size_state& state = this->find_size(num_bytes_in_prime_number);
+	statistics result = state.stats;
+	result.num_ready = state.ready.size();
+	return result;
+}
+
+template class cryptb::basic_rsa_key_pool<boost::multiprecision::cpp_int>;
+template class cryptb::basic_rsa_key_pool<cryptb::fixed_uint<1024>>;
+template class cryptb::basic_rsa_key_pool<cryptb::fixed_uint<2048>>;
+template class cryptb::basic_rsa_key_pool<cryptb::fixed_uint<3072>>;
+template class cryptb::basic_rsa_key_pool<cryptb::fixed_uint<4096>>;
+#ifdef CRYPTB_WITH_GMP
+template class cryptb::basic_rsa_key_pool<boost::multiprecision::mpz_int>;
+#endif
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "rsa.hpp"
+#include "random_engine.hpp"
+#include <boost/optional.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cryptb
+{
+	// Keeps ready-made RSA key pairs so that nobody has to wait for key generation
+	// (which takes seconds for 4096-bit keys) on their request path.
+	//
+	// Background threads refill the pool whenever it isn't full,
+	// always topping up the key size that's the emptiest first.
+	// Handing out a key is O(1) and the key is moved out of the pool, never copied.
+	//
+	// Don't destroy the pool while other threads are still calling "acquire".
+	// The destructor cancels the key generations that already started (see basic_rsa's "stop_requested"),
+	// so it only waits for the candidate that each background thread is testing right then.
+	template <typename int_T>
+	class basic_rsa_key_pool
+	{
+	public:
+		// Numbers for sizing the pool. All of them are per key size.
+		struct statistics
+		{
+			// Number of keys that are ready to be handed out right now
+			std::size_t num_ready = 0;
+			std::size_t capacity = 0;
+			// The smallest "num_ready" seen right after handing out a key.
+			// If it gets to 0, the pool is too small (or refills too slowly).
+			std::size_t low_water_mark = 0;
+			std::uint64_t num_generated = 0;
+			// Key generations that threw (see acquire)
+			std::uint64_t num_failed = 0;
+			// Total time the background threads spent generating keys of this size
+			std::uint64_t generation_nanoseconds = 0;
+			std::uint64_t num_acquired = 0;
+			// How many of the "acquire" calls had to wait for a key to be generated
+			std::uint64_t num_waited = 0;
+			std::uint64_t total_wait_nanoseconds = 0;
+			std::uint64_t max_wait_nanoseconds = 0;
+			// Totals of all of the key generations of this size:
+			// how many candidates and retries it took and which phase the time went to
+			keygen_stats keygen;
+
+			// Keys per second that a single background thread generates
+			double refill_rate() const
+			{
+				if (this->generation_nanoseconds == 0)
+					return 0;
+				return static_cast<double>(this->num_generated) * 1e9 / static_cast<double>(this->generation_nanoseconds);
+			}
+		};
+
+	private:
+		struct key_size_state
+		{
+			int num_bytes_in_prime_number = 0;
+			std::deque<basic_rsa<int_T>> ready;
+			// Keys that a background thread is generating right now
+			std::size_t num_in_progress = 0;
+			// What the last failed key generation threw, until an acquire / try_acquire rethrows it.
+			// The background threads don't refill this key size while it's set.
+			std::exception_ptr error;
+			statistics stats;
+		};
+
+		mutable std::mutex m_mutex;
+		// Notified whenever a key is taken out (there's room to refill) or on shutdown
+		std::condition_variable m_room_available;
+		// Notified whenever a key is added
+		std::condition_variable m_key_available;
+		std::vector<key_size_state> m_sizes;
+		std::size_t m_capacity = 0;
+		bool m_stopping = false;
+		// Set together with m_stopping, for the key generations in progress (they don't hold the lock).
+		std::atomic<bool> m_stop_requested{ false };
+		std::vector<std::thread> m_threads;
+
+		key_size_state& find_size(const int num_bytes_in_prime_number);
+		const key_size_state& find_size(const int num_bytes_in_prime_number) const;
+		basic_rsa<int_T> take_front(key_size_state& state);
+		void rethrow_error(key_size_state& state);
+		void refill_loop(random_engine engine);
+
+	public:
+		// "num_bytes_in_prime_numbers" lists the key sizes to keep ready,
+		// in the same units as the basic_rsa constructor (128 is 2048-bit RSA).
+		// "capacity" keys are kept ready for each of them.
+		// Each of the "num_threads" background threads gets its own engine forked from "rand".
+		basic_rsa_key_pool(random_engine& rand, const std::vector<int>& num_bytes_in_prime_numbers, const std::size_t capacity, const int num_threads = 1);
+		basic_rsa_key_pool(const basic_rsa_key_pool&) = delete;
+		basic_rsa_key_pool& operator=(const basic_rsa_key_pool&) = delete;
+		~basic_rsa_key_pool();
+
+		// Hands out a key, waiting for one to be generated if the pool is empty.
+		// If a background key generation of this size failed (threw) while the pool was empty,
+		// rethrows that exception instead. The pool then starts refilling this size again.
+		basic_rsa<int_T> acquire(const int num_bytes_in_prime_number);
+
+		// Hands out a key or returns boost::none right away if the pool is empty.
+		// Rethrows the exception of a failed key generation like acquire does.
+		boost::optional<basic_rsa<int_T>> try_acquire(const int num_bytes_in_prime_number);
+
+		statistics get_statistics(const int num_bytes_in_prime_number) const;
+	};
+
+	using rsa_key_pool = basic_rsa_key_pool<boost::multiprecision::cpp_int>;
+
+	template <unsigned Bits>
+	using fixed_rsa_key_pool = basic_rsa_key_pool<fixed_uint<Bits>>;
+
+	extern template class basic_rsa_key_pool<boost::multiprecision::cpp_int>;
+	extern template class basic_rsa_key_pool<fixed_uint<1024>>;
+	extern template class basic_rsa_key_pool<fixed_uint<2048>>;
+	extern template class basic_rsa_key_pool<fixed_uint<3072>>;
+	extern template class basic_rsa_key_pool<fixed_uint<4096>>;
+
+#ifdef CRYPTB_WITH_GMP
+	using gmp_rsa_key_pool = basic_rsa_key_pool<boost::multiprecision::mpz_int>;
+
+	extern template class basic_rsa_key_pool<boost::multiprecision::mpz_int>;
+#endif
+}
@@ -1,4 +1,6 @@
 #include "sha512.hpp"
+#include "cpu_features.hpp"
+#include "trace.hpp"
 #include <limits>
 #include <algorithm>
 #include <stdexcept>
@@ -26,28 +28,83 @@ void cryptb::sha512::update(const std::uint8_t* const data, const std::size_t le
 		throw std::logic_error("Error in function \"sha512::update\"."
 			" \"this->m_num_bytes_filled\" is out of range.");
 	}
-	for (std::size_t index_in_data = 0; index_in_data < len; )
+	std::size_t index_in_data = 0;
+	// Top up the partial message block that's left from the previous calls
+	if (this->m_num_bytes_filled != 0)
 	{
-		// Compress if needed
+		if (this->m_num_bytes_filled == sha512::message_block_size_bytes)
+		{
+			sha512::compress(this->m_message_block, this->m_hash_values);
+			this->m_num_bytes_filled = 0;
+		}
+		else
 		{
 			const int num_bytes_unfilled_in_message_block = sha512::message_block_size_bytes - this->m_num_bytes_filled;
-			if (num_bytes_unfilled_in_message_block == 0)
+			const int bytes_to_copy = static_cast<int>(std::min<std::size_t>(len, static_cast<std::size_t>(num_bytes_unfilled_in_message_block)));
+			sha512::copy_arr_bytes_into_message_block(data, bytes_to_copy, this->m_message_block, this->m_num_bytes_filled);
+			this->m_num_bytes_filled += bytes_to_copy;
+			index_in_data += bytes_to_copy;
+			if (this->m_num_bytes_filled == sha512::message_block_size_bytes && index_in_data < len)
 			{
-				sha512::compress(this->m_message_block, m_hash_values);
+				sha512::compress(this->m_message_block, this->m_hash_values);
 				this->m_num_bytes_filled = 0;
 			}
 		}
-		const int num_bytes_unfilled_in_message_block = sha512::message_block_size_bytes - this->m_num_bytes_filled;
-		const std::size_t num_bytes_remaining_in_data = len - index_in_data;
-		const int bytes_to_copy = static_cast<int>(std::min<std::size_t>(num_bytes_remaining_in_data, static_cast<std::size_t>(num_bytes_unfilled_in_message_block)));
+	}
+	// All of the whole blocks straight from "data", without copying them into m_message_block
+	if (this->m_num_bytes_filled == 0)
+	{
+		const std::size_t num_whole_blocks = (len - index_in_data) / sha512::message_block_size_bytes;
+		sha512::compress_blocks(&data[index_in_data], num_whole_blocks, this->m_hash_values);
+		index_in_data += num_whole_blocks * sha512::message_block_size_bytes;
+	}
+	// Keep the tail for the next call (or for "digest")
+	if (index_in_data < len)
+	{
+		const int bytes_to_copy = static_cast<int>(len - index_in_data);
 		sha512::copy_arr_bytes_into_message_block(&data[index_in_data], bytes_to_copy, this->m_message_block, this->m_num_bytes_filled);
 		this->m_num_bytes_filled += bytes_to_copy;
-		index_in_data += bytes_to_copy;
 	}
 	// Times 8 to convert from bytes to bits
 	this->m_bits_counter += static_cast<decltype(this->m_bits_counter)>(len) << 3;
 }
 
+cryptb::sha512::sha512(const midstate_t& midstate)
+{
+	for (int index = 0; index < static_cast<int>(this->m_hash_values.size()); ++index)
+	{
+		this->m_hash_values[index] = boost::endian::load_big_u64(midstate.data() + index * 8LL);
+	}
+	const std::uint8_t* const bits_counter_bytes = midstate.data() + this->m_hash_values.size() * 8;
+	this->m_bits_counter = boost::endian::load_big_u64(bits_counter_bytes);
+	this->m_bits_counter <<= 64;
+	this->m_bits_counter |= boost::endian::load_big_u64(bits_counter_bytes + 8);
+	if ((this->m_bits_counter % sha512::message_block_size_bits) != 0)
+	{
+		throw std::invalid_argument("Error in function \"sha512::sha512\"."
+			" The length in \"midstate\" isn\'t a whole number of message blocks.");
+	}
+}
+
+boost::optional<cryptb::sha512::midstate_t> cryptb::sha512::export_midstate() const
+{
+	std::array<std::uint64_t, 8> hash_values = this->m_hash_values;
+	// A full message block is only compressed on the next call to "update", do it on the copy now.
+	if (this->m_num_bytes_filled == sha512::message_block_size_bytes)
+		sha512::compress(this->m_message_block, hash_values);
+	else if (this->m_num_bytes_filled != 0)
+		return boost::none;
+	midstate_t midstate{ {0} };
+	for (int index = 0; index < static_cast<int>(hash_values.size()); ++index)
+	{
+		boost::endian::store_big_u64(midstate.data() + index * 8LL, hash_values[index]);
+	}
+	std::uint8_t* const bits_counter_bytes = midstate.data() + hash_values.size() * 8;
+	boost::endian::store_big_u64(bits_counter_bytes, static_cast<std::uint64_t>(this->m_bits_counter >> 64));
+	boost::endian::store_big_u64(bits_counter_bytes + 8, static_cast<std::uint64_t>(this->m_bits_counter));
+	return midstate;
+}
+
 void cryptb::sha512::zero_bytes(message_block_t& messsage_block, int index_byte_to_start_zeroing)
 {
 	if (index_byte_to_start_zeroing < 0 || index_byte_to_start_zeroing >= sha512::message_block_size_bytes)
@@ -280,7 +337,77 @@ void cryptb::sha512::copy_arr_bytes_into_message_block(const std::uint8_t* const
 		}
 	}
 }
-void cryptb::sha512::compress(const message_block_t & message_block, std::array<std::uint64_t, 8>&hash_values)
+
+std::atomic<cryptb::sha512::compress_function_t>& cryptb::sha512::selected_compress()
+{
+	static std::atomic<compress_function_t> selected{
+		sha512::is_supported(compress_implementation::avx2) ? &sha512::compress_avx2 : &sha512::compress_scalar };
+	return selected;
+}
+
+void cryptb::sha512::compress(const message_block_t& message_block, std::array<std::uint64_t, 8>& hash_values)
+{
+	CRYPTB_TRACE_SCOPE(trace::event::sha512_compress);
+	sha512::selected_compress().load(std::memory_order_relaxed)(message_block, hash_values);
+}
+
+void cryptb::sha512::compress_blocks(const std::uint8_t* const bytes, const std::size_t num_blocks, std::array<std::uint64_t, 8>& hash_values)
+{
+	const compress_function_t compress_function = sha512::selected_compress().load(std::memory_order_relaxed);
+	message_block_t message_block;
+	for (std::size_t index_block = 0; index_block < num_blocks; ++index_block)
+	{
+		const std::uint8_t* const block_bytes = bytes + index_block * sha512::message_block_size_bytes;
+		for (int index_word = 0; index_word < static_cast<int>(message_block.size()); ++index_word)
+		{
+			message_block[index_word] = boost::endian::load_big_u64(block_bytes + index_word * 8LL);
+		}
+		CRYPTB_TRACE_SCOPE(trace::event::sha512_compress);
+		compress_function(message_block, hash_values);
+	}
+}
+
+bool cryptb::sha512::is_supported(const compress_implementation implementation)
+{
+	switch (implementation)
+	{
+	case compress_implementation::scalar:
+		return true;
+	case compress_implementation::avx2:
+	{
+		const cpu_features& features = cpu_features::get();
+		return features.avx2 && features.bmi1 && features.bmi2;
+	}
+	}
+	return false;
+}
+
+cryptb::sha512::compress_implementation cryptb::sha512::get_compress_implementation()
+{
+	if (sha512::selected_compress().load(std::memory_order_relaxed) == &sha512::compress_avx2)
+		return compress_implementation::avx2;
+	return compress_implementation::scalar;
+}
+
+void cryptb::sha512::set_compress_implementation(const compress_implementation implementation)
+{
+	if (!sha512::is_supported(implementation))
+	{
+		throw std::invalid_argument("Error in function \"sha512::set_compress_implementation\"."
+			" The CPU doesn\'t support the requested implementation.");
+	}
+	switch (implementation)
+	{
+	case compress_implementation::scalar:
+		sha512::selected_compress().store(&sha512::compress_scalar, std::memory_order_relaxed);
+		break;
+	case compress_implementation::avx2:
+		sha512::selected_compress().store(&sha512::compress_avx2, std::memory_order_relaxed);
+		break;
+	}
+}
+
+void cryptb::sha512::compress_scalar(const message_block_t& message_block, std::array<std::uint64_t, 8>& hash_values)
 {
 	std::array<std::uint64_t, 80> message_schedule{ {0} };
 
@@ -294,24 +421,6 @@ void cryptb::sha512::compress(const message_block_t & message_block, std::array<
 			+ message_schedule[word_index - 16LL];
 	}
 
-	constexpr std::uint64_t constants[80]{
-		0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL,
-		0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL, 0x12835b0145706fbeULL,
-		0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL, 0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
-		0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
-		0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL, 0x983e5152ee66dfabULL,
-		0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
-		0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL,
-		0x53380d139d95b3dfULL, 0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
-		0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
-		0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL, 0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL,
-		0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL,
-		0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
-		0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL, 0xca273eceea26619cULL,
-		0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL,
-		0x113f9804bef90daeULL, 0x1b710b35131c471bULL, 0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
-		0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
-	};
 	std::uint64_t a = hash_values[0];
 	std::uint64_t b = hash_values[1];
 	std::uint64_t c = hash_values[2];
@@ -322,7 +431,7 @@ void cryptb::sha512::compress(const message_block_t & message_block, std::array<
 	std::uint64_t h = hash_values[7];
 	for (int word_index = 0; word_index < 80; ++word_index)
 	{
-		const std::uint64_t T1 = sha512::uppercase_sigma1(e) + sha512::choice(e, f, g) + h + constants[word_index] + message_schedule[word_index];
+		const std::uint64_t T1 = sha512::uppercase_sigma1(e) + sha512::choice(e, f, g) + h + sha512::round_constants[word_index] + message_schedule[word_index];
 		const std::uint64_t T2 = sha512::uppercase_sigma0(a) + sha512::majority(a, b, c);
 		h = g;
 		g = f;
@@ -4,12 +4,22 @@
 #include <cstdint>
 #include <type_traits>
 #include <array>
+#include <atomic>
+#include <filesystem>
 #include <boost/multiprecision/cpp_int.hpp>
+#include <boost/optional.hpp>
 
 namespace cryptb
 {
 	class sha512
 	{
+		// Shares the constants and the round functions
+		friend class sha512_multi;
+
+		static constexpr std::array<std::uint64_t, 8> initial_hash_values{ {
+		0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+		0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL } };
+
 		// The hash size in bits
 		static constexpr int hash_digest_size_in_bits{ 512 };
 		// The hash size in bytes
@@ -23,9 +33,7 @@ namespace cryptb
 
 		// Current hash values, of the concatenation of all of the message
 		// blocks that we went through until now not including the current message block.
-		std::array<std::uint64_t, 8> m_hash_values{ {
-		0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
-		0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL } };
+		std::array<std::uint64_t, 8> m_hash_values{ sha512::initial_hash_values };
 
 		using message_block_t = std::array<std::uint64_t, message_block_size_bits / 64>;
 
@@ -53,6 +61,22 @@ namespace cryptb
 
 		sha512(const std::uint8_t* const data, const std::size_t len) { this->update(data, len); }
 
+		// The state of the hash right after a whole number of message blocks, as bytes:
+		// the 8 hash values and then the 128-bit length of the message so far in bits,
+		// all of them big-endian.
+		//
+		// Lets a long common prefix be hashed once: export the state after the prefix,
+		// and start every message from it with the constructor below.
+		using midstate_t = std::array<std::uint8_t, 8 * 8 + 16>;
+
+		// Continues hashing from a state that "export_midstate" returned.
+		// Throws std::invalid_argument if the length in "midstate" isn't a whole number of message blocks.
+		explicit sha512(const midstate_t& midstate);
+
+		// boost::none if the length of the message so far isn't a multiple of 128 bytes
+		// (there's no midstate in the middle of a message block).
+		boost::optional<midstate_t> export_midstate() const;
+
 		// Appends another part of the message to be concatenated.
 		// Even though that sounds expensive, the memory usage is constant.
 		void update(const std::uint8_t* const data, const std::size_t len);
@@ -62,6 +86,48 @@ namespace cryptb
 		// At any point you can ask for the hash of the concatenated data so far
 		digest_t digest() const;
 
+		// The hash of the whole contents of a file, without reading it into memory.
+		//
+		// On POSIX the file is memory mapped a window at a time with madvise(MADV_SEQUENTIAL),
+		// and the kernel is asked to start reading the next window (MADV_WILLNEED) before
+		// the current one is hashed, so the disk and the hashing work at the same time.
+		// Every window is unmapped when it's done so the memory usage stays constant
+		// even for files that are larger than the RAM.
+		// If the file can't be mapped (a pipe for example) it's read in large chunks instead.
+		// Like any memory mapped reading, the file must not shrink (be truncated) while it's hashed:
+		// touching a mapped page past the new end of the file raises SIGBUS, which kills the process.
+		// The size is checked again before every window is mapped (and std::runtime_error thrown
+		// if it shrank), but that can't catch a truncation in the middle of a window.
+		// On other platforms the file is read in large chunks with std::ifstream.
+		//
+		// Throws std::runtime_error if the file can't be opened or read.
+		static digest_t hash_file(const std::filesystem::path& path);
+
+		// Same as the function above, but gives up and returns boost::none as soon as it sees
+		// that "stop_requested" was set (by another thread). Checked after every 1 MiB.
+		static boost::optional<digest_t> hash_file(const std::filesystem::path& path, const std::atomic<bool>& stop_requested);
+
+		// The compression function has several implementations.
+		// The fastest one that the CPU supports is chosen automatically (using CPUID)
+		// the first time anything is hashed. All of them give the exact same results.
+		enum class compress_implementation
+		{
+			// Portable C++, works everywhere
+			scalar,
+			// x86-64 only: message schedule vectorized with AVX2,
+			// rounds with BMI1 / BMI2 instructions
+			avx2
+		};
+
+		static bool is_supported(const compress_implementation implementation);
+
+		static compress_implementation get_compress_implementation();
+
+		// Overrides the automatic choice, for every sha512 object in the program.
+		// Mostly useful for cross-checking and benchmarking the implementations.
+		// Throws std::invalid_argument if the CPU doesn't support "implementation".
+		static void set_compress_implementation(const compress_implementation implementation);
+
 		~sha512() = default;
 	private:
 		template <typename x_T, int amount>
@@ -134,8 +200,42 @@ namespace cryptb
 			// element in the array, in big-endian style.
 			const int num_bytes_already_used_in_message_block);
 
+		static constexpr std::array<std::uint64_t, 80> round_constants{ {
+			0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL,
+			0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL, 0x12835b0145706fbeULL,
+			0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL, 0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+			0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+			0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL, 0x983e5152ee66dfabULL,
+			0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+			0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL,
+			0x53380d139d95b3dfULL, 0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+			0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+			0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL, 0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL,
+			0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL,
+			0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+			0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL, 0xca273eceea26619cULL,
+			0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL,
+			0x113f9804bef90daeULL, 0x1b710b35131c471bULL, 0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+			0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+		} };
+
+		using compress_function_t = void (*)(const message_block_t& message_block, std::array<std::uint64_t, 8>& hash_values);
+
+		// Calls the selected implementation
 		static void compress(const message_block_t& message_block, std::array<std::uint64_t, 8>& hash_values);
 
+		// Compresses "num_blocks" whole message blocks, read directly from "bytes" (big-endian).
+		static void compress_blocks(const std::uint8_t* const bytes, const std::size_t num_blocks, std::array<std::uint64_t, 8>& hash_values);
+
+		// The function that "compress" calls. Chosen on first use.
+		static std::atomic<compress_function_t>& selected_compress();
+
+		static void compress_scalar(const message_block_t& message_block, std::array<std::uint64_t, 8>& hash_values);
+
+		// Defined in sha512_avx2.cpp
+		// Only call when sha512::is_supported(compress_implementation::avx2) returns true.
+		static void compress_avx2(const message_block_t& message_block, std::array<std::uint64_t, 8>& hash_values);
+
 		// Index of byte in array of uint64_t based on big-endian byte order.
 		static void zero_bytes(message_block_t& messsage_block, int index_byte_to_start_zeroing);
 	};
@@ -0,0 +1,187 @@
+#include "sha512.hpp"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// sha512::hash_file, separate from sha512.cpp because of the platform specific headers.
+
+namespace
+{
+	// Big enough that the system calls don't matter, small enough to stay in the cache.
+	constexpr std::size_t read_chunk_size = 1 << 20;
+
+	std::runtime_error file_error(const char* const what, const std::filesystem::path& path)
+	{
+		return std::runtime_error(std::string("Error in function \"sha512::hash_file\". ")
+			+ what + " \"" + path.string() + "\".");
+	}
+
+	// "stop_requested" is nullptr when the caller can't stop the hashing.
+	bool is_stop_requested(const std::atomic<bool>* const stop_requested)
+	{
+		return stop_requested != nullptr && stop_requested->load(std::memory_order_relaxed);
+	}
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+	// How much of the file is mapped at a time.
+	// A multiple of every page size and of the 128 byte message block,
+	// so only the very last window leaves a partial message block.
+	constexpr std::size_t map_window_size = 64 << 20;
+
+	class file_descriptor
+	{
+		int m_fd = -1;
+	public:
+		explicit file_descriptor(const int fd) : m_fd(fd) {}
+		file_descriptor(const file_descriptor&) = delete;
+		file_descriptor& operator=(const file_descriptor&) = delete;
+		~file_descriptor()
+		{
+			if (this->m_fd >= 0)
+				::close(this->m_fd);
+		}
+		int get() const
+		{
+			return this->m_fd;
+		}
+	};
+
+	// Returns false (without hashing anything) if the first window can't be mapped.
+	// Stops early (and returns true) when "stop_requested" is set.
+	bool hash_mapped(const int fd, const std::size_t file_size, cryptb::sha512& hash, const std::filesystem::path& path,
+		const std::atomic<bool>* const stop_requested)
+	{
+		for (std::size_t offset = 0; offset < file_size; offset += map_window_size)
+		{
+			const std::size_t window_size = std::min(map_window_size, file_size - offset);
+			// Touching a mapped page past the end of the file raises SIGBUS, so make sure the file
+			// didn't shrink since the last window. That only narrows the race: truncating the file
+			// while a window is being hashed still kills the process (see sha512::hash_file).
+			if (offset != 0)
+			{
+				struct stat info {};
+				if (::fstat(fd, &info) != 0)
+					throw file_error("Failed to get the size of", path);
+				if (static_cast<std::size_t>(info.st_size) < offset + window_size)
+					throw file_error("The file shrank while it was being hashed:", path);
+			}
+			void* const window = ::mmap(nullptr, window_size, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+			if (window == MAP_FAILED)
+			{
+				if (offset == 0)
+					return false;
+				throw file_error("Failed to map part of the file", path);
+			}
+			::madvise(window, window_size, MADV_SEQUENTIAL);
+#ifdef POSIX_FADV_WILLNEED
+			// Starts reading the next window from the disk in the background while this one is hashed.
+			if (offset + window_size < file_size)
+				::posix_fadvise(fd, static_cast<off_t>(offset + window_size), static_cast<off_t>(map_window_size), POSIX_FADV_WILLNEED);
+#endif
+			// One chunk at a time so that a stop request doesn't wait for the whole window.
+			for (std::size_t chunk = 0; chunk < window_size && !is_stop_requested(stop_requested); chunk += read_chunk_size)
+			{
+				hash.update(static_cast<const std::uint8_t*>(window) + chunk, std::min(read_chunk_size, window_size - chunk));
+			}
+			// Unmapping right away keeps the memory usage at one window.
+			::munmap(window, window_size);
+			if (is_stop_requested(stop_requested))
+				break;
+		}
+		return true;
+	}
+
+	void hash_read(const int fd, cryptb::sha512& hash, const std::filesystem::path& path, const std::atomic<bool>* const stop_requested)
+	{
+#ifdef POSIX_FADV_SEQUENTIAL
+		// Makes the kernel read ahead more aggressively. Fails harmlessly on pipes.
+		::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+		const std::unique_ptr<std::uint8_t[]> buffer{ new std::uint8_t[read_chunk_size] };
+		while (!is_stop_requested(stop_requested))
+		{
+			const ssize_t num_bytes_read = ::read(fd, buffer.get(), read_chunk_size);
+			if (num_bytes_read < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				throw file_error("Failed to read the file", path);
+			}
+			if (num_bytes_read == 0)
+				return;
+			hash.update(buffer.get(), static_cast<std::size_t>(num_bytes_read));
+		}
+	}
+
+	boost::optional<cryptb::sha512::digest_t> hash_file_until(const std::filesystem::path& path, const std::atomic<bool>* const stop_requested)
+	{
+		using cryptb::sha512;
+		const file_descriptor file{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+		if (file.get() < 0)
+			throw file_error("Failed to open", path);
+		struct stat info {};
+		if (::fstat(file.get(), &info) != 0)
+			throw file_error("Failed to get the size of", path);
+
+		sha512 hash;
+		// Only regular files can be mapped, and mmap doesn't accept a length of 0.
+		const bool mappable = S_ISREG(info.st_mode) && info.st_size > 0;
+		if (!mappable || !hash_mapped(file.get(), static_cast<std::size_t>(info.st_size), hash, path, stop_requested))
+			hash_read(file.get(), hash, path, stop_requested);
+		if (is_stop_requested(stop_requested))
+			return boost::none;
+		return hash.digest();
+	}
+}
+
+#else
+
+#include <fstream>
+
+namespace
+{
+	boost::optional<cryptb::sha512::digest_t> hash_file_until(const std::filesystem::path& path, const std::atomic<bool>* const stop_requested)
+	{
+		using cryptb::sha512;
+		std::ifstream file{ path, std::ios::binary };
+		if (!file)
+			throw file_error("Failed to open", path);
+		sha512 hash;
+		const std::unique_ptr<char[]> buffer{ new char[read_chunk_size] };
+		while (file)
+		{
+			if (is_stop_requested(stop_requested))
+				return boost::none;
+			file.read(buffer.get(), static_cast<std::streamsize>(read_chunk_size));
+			const std::streamsize num_bytes_read = file.gcount();
+			if (num_bytes_read > 0)
+				hash.update(reinterpret_cast<const std::uint8_t*>(buffer.get()), static_cast<std::size_t>(num_bytes_read));
+		}
+		if (!file.eof())
+			throw file_error("Failed to read the file", path);
+		return hash.digest();
+	}
+}
+
+#endif
+
+cryptb::sha512::digest_t cryptb::sha512::hash_file(const std::filesystem::path& path)
+{
+	return hash_file_until(path, nullptr).get();
+}
+
+boost::optional<cryptb::sha512::digest_t> cryptb::sha512::hash_file(const std::filesystem::path& path, const std::atomic<bool>& stop_requested)
+{
+	return hash_file_until(path, &stop_requested);
+}
@@ -0,0 +1,385 @@
+#include "sha512_multi.hpp"
+#include "cpu_features.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <boost/endian/conversion.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define CRYPTB_SHA512_MULTI_X86_64
+#endif
+
+// The SIMD kernels are compiled with per-function target attributes (GCC / Clang)
+// so that the rest of the library doesn't use AVX2 or AVX-512 by accident.
+// MSVC doesn't need them.
+#if defined(__GNUC__) || defined(__clang__)
+#define CRYPTB_TARGET_AVX2 __attribute__((target("avx2")))
+#define CRYPTB_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define CRYPTB_TARGET_AVX2
+#define CRYPTB_TARGET_AVX512
+#endif
+
+bool cryptb::sha512_multi::is_supported(const implementation impl)
+{
+	switch (impl)
+	{
+	case implementation::scalar:
+		return true;
+	case implementation::avx2:
+		return cpu_features::get().avx2;
+	case implementation::avx512:
+		return cpu_features::get().avx512f;
+	}
+	return false;
+}
+
+cryptb::sha512_multi::implementation cryptb::sha512_multi::get_default_implementation()
+{
+	if (sha512_multi::is_supported(implementation::avx512))
+		return implementation::avx512;
+	if (sha512_multi::is_supported(implementation::avx2))
+		return implementation::avx2;
+	return implementation::scalar;
+}
+
+void cryptb::sha512_multi::digest(std::span<const message> messages, std::span<sha512::digest_t> digests)
+{
+	sha512_multi::digest(messages, digests, sha512_multi::get_default_implementation());
+}
+
+void cryptb::sha512_multi::digest(std::span<const message> messages, std::span<sha512::digest_t> digests, const implementation impl)
+{
+	if (messages.size() != digests.size())
+	{
+		throw std::invalid_argument("Error in function \"sha512_multi::digest\"."
+			" \"messages\" and \"digests\" must have the same size.");
+	}
+	for (const message& msg : messages)
+	{
+		if (msg.data == nullptr && msg.len != 0)
+		{
+			throw std::invalid_argument("Error in function \"sha512_multi::digest\"."
+				" A message has nullptr \"data\" with nonzero \"len\".");
+		}
+	}
+	if (!sha512_multi::is_supported(impl))
+	{
+		throw std::invalid_argument("Error in function \"sha512_multi::digest\"."
+			" The CPU doesn\'t support the requested implementation.");
+	}
+	switch (impl)
+	{
+	case implementation::scalar:
+		for (std::size_t index = 0; index < messages.size(); ++index)
+		{
+			sha512 hash;
+			// sha512::update doesn't accept empty messages
+			if (messages[index].len != 0)
+				hash.update(messages[index].data, messages[index].len);
+			digests[index] = hash.digest();
+		}
+		break;
+	case implementation::avx2:
+		sha512_multi::digest_in_lanes<4>(messages, digests);
+		break;
+	case implementation::avx512:
+		sha512_multi::digest_in_lanes<8>(messages, digests);
+		break;
+	}
+}
+
+template <int num_lanes>
+void cryptb::sha512_multi::load_block(const message& msg, const std::size_t block_index, lanes_block_t<num_lanes>& blocks, const int lane_index)
+{
+	constexpr std::size_t block_size = sha512::message_block_size_bytes;
+	const std::size_t offset = block_index * block_size;
+	if (msg.len >= block_size && offset <= msg.len - block_size)
+	{
+		// The common case, straight from the message
+		for (int word_index = 0; word_index < 16; ++word_index)
+		{
+			blocks[word_index][lane_index] = boost::endian::load_big_u64(msg.data + offset + word_index * 8LL);
+		}
+		return;
+	}
+	// One of the last 1 or 2 blocks: the rest of the message, the 1 terminating bit,
+	// zeros and (in the very last block) the 128-bit length in bits.
+	std::uint8_t buffer[block_size]{};
+	if (offset <= msg.len)
+	{
+		const std::size_t num_bytes_left = msg.len - offset;
+		if (num_bytes_left != 0)
+			std::memcpy(buffer, msg.data + offset, num_bytes_left);
+		buffer[num_bytes_left] = 0x80;
+	}
+	const std::size_t num_blocks = (msg.len + 1 + 16 + block_size - 1) / block_size;
+	if (block_index == num_blocks - 1)
+	{
+		boost::endian::store_big_u64(buffer + block_size - 16, static_cast<std::uint64_t>(msg.len) >> 61);
+		boost::endian::store_big_u64(buffer + block_size - 8, static_cast<std::uint64_t>(msg.len) << 3);
+	}
+	for (int word_index = 0; word_index < 16; ++word_index)
+	{
+		blocks[word_index][lane_index] = boost::endian::load_big_u64(buffer + word_index * 8LL);
+	}
+}
+
+template <int num_lanes>
+void cryptb::sha512_multi::digest_in_lanes(std::span<const message> messages, std::span<sha512::digest_t> digests)
+{
+	struct lane
+	{
+		bool active = false;
+		std::size_t message_index = 0;
+		std::size_t block_index = 0;
+		std::size_t num_blocks = 0;
+	};
+	lane lanes[num_lanes];
+	alignas(64) lanes_state_t<num_lanes> state{};
+	alignas(64) lanes_block_t<num_lanes> blocks{};
+
+	std::size_t next_message_index = 0;
+	int num_active = 0;
+	const auto start_next_message = [&](const int lane_index) -> void
+	{
+		lane& current = lanes[lane_index];
+		current.active = next_message_index < messages.size();
+		if (!current.active)
+			return;
+		current.message_index = next_message_index++;
+		current.block_index = 0;
+		current.num_blocks = (messages[current.message_index].len + 1 + 16 + sha512::message_block_size_bytes - 1) / sha512::message_block_size_bytes;
+		for (int word_index = 0; word_index < 8; ++word_index)
+		{
+			state[word_index][lane_index] = sha512::initial_hash_values[word_index];
+		}
+		++num_active;
+	};
+	for (int lane_index = 0; lane_index < num_lanes; ++lane_index)
+	{
+		start_next_message(lane_index);
+	}
+	while (num_active > 0)
+	{
+		// Idle lanes (no messages left) just hash whatever was in their block before.
+		for (int lane_index = 0; lane_index < num_lanes; ++lane_index)
+		{
+			const lane& current = lanes[lane_index];
+			if (current.active)
+				sha512_multi::load_block<num_lanes>(messages[current.message_index], current.block_index, blocks, lane_index);
+		}
+		sha512_multi::compress_lanes(state, blocks);
+		for (int lane_index = 0; lane_index < num_lanes; ++lane_index)
+		{
+			lane& current = lanes[lane_index];
+			if (!current.active || ++current.block_index != current.num_blocks)
+				continue;
+			sha512::digest_t& result = digests[current.message_index];
+			for (int word_index = 0; word_index < 8; ++word_index)
+			{
+				boost::endian::store_big_u64(result.data() + word_index * 8LL, state[word_index][lane_index]);
+			}
+			--num_active;
+			start_next_message(lane_index);
+		}
+	}
+}
+
+#ifdef CRYPTB_SHA512_MULTI_X86_64
+
+// The same operations on 4 lanes (AVX2) and on 8 lanes (AVX-512),
+// overloaded so that the round macro below works for both.
+namespace
+{
+	CRYPTB_TARGET_AVX2 inline __m256i add(const __m256i x, const __m256i y)
+	{
+		return _mm256_add_epi64(x, y);
+	}
+
+	CRYPTB_TARGET_AVX2 inline __m256i broadcast(const __m256i&, const std::uint64_t x)
+	{
+		return _mm256_set1_epi64x(static_cast<long long>(x));
+	}
+
+	// AVX2 doesn't have a rotate instruction
+	template <int amount>
+	CRYPTB_TARGET_AVX2 inline __m256i rotate_right(const __m256i x)
+	{
+		return _mm256_or_si256(_mm256_srli_epi64(x, amount), _mm256_slli_epi64(x, 64 - amount));
+	}
+
+	template <int amount>
+	CRYPTB_TARGET_AVX2 inline __m256i shift_right(const __m256i x)
+	{
+		return _mm256_srli_epi64(x, amount);
+	}
+
+	CRYPTB_TARGET_AVX2 inline __m256i xor3(const __m256i x, const __m256i y, const __m256i z)
+	{
+		return _mm256_xor_si256(_mm256_xor_si256(x, y), z);
+	}
+
+	// sha512::choice with one operation less: ((y ^ z) & x) ^ z
+	CRYPTB_TARGET_AVX2 inline __m256i choice(const __m256i x, const __m256i y, const __m256i z)
+	{
+		return _mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(y, z), x), z);
+	}
+
+	// sha512::majority with one operation less: (x & y) | (z & (x | y))
+	CRYPTB_TARGET_AVX2 inline __m256i majority(const __m256i x, const __m256i y, const __m256i z)
+	{
+		return _mm256_or_si256(_mm256_and_si256(x, y), _mm256_and_si256(z, _mm256_or_si256(x, y)));
+	}
+
+	CRYPTB_TARGET_AVX512 inline __m512i add(const __m512i x, const __m512i y)
+	{
+		return _mm512_add_epi64(x, y);
+	}
+
+	CRYPTB_TARGET_AVX512 inline __m512i broadcast(const __m512i&, const std::uint64_t x)
+	{
+		return _mm512_set1_epi64(static_cast<long long>(x));
+	}
+
+	// The zero-masked forms with every lane selected are the same instructions.
+	// GCC 12 implements the unmasked ones with an uninitialized source vector,
+	// which floods -Wall builds with -Wuninitialized / -Wmaybe-uninitialized warnings.
+
+	template <int amount>
+	CRYPTB_TARGET_AVX512 inline __m512i rotate_right(const __m512i x)
+	{
+		return _mm512_maskz_ror_epi64(0xFF, x, amount);
+	}
+
+	template <int amount>
+	CRYPTB_TARGET_AVX512 inline __m512i shift_right(const __m512i x)
+	{
+		return _mm512_maskz_srli_epi64(0xFF, x, amount);
+	}
+
+	// The truth tables for vpternlogq are the functions applied to
+	// x = 0b11110000, y = 0b11001100, z = 0b10101010
+
+	CRYPTB_TARGET_AVX512 inline __m512i xor3(const __m512i x, const __m512i y, const __m512i z)
+	{
+		return _mm512_ternarylogic_epi64(x, y, z, 0x96);
+	}
+
+	CRYPTB_TARGET_AVX512 inline __m512i choice(const __m512i x, const __m512i y, const __m512i z)
+	{
+		return _mm512_ternarylogic_epi64(x, y, z, 0xCA);
+	}
+
+	CRYPTB_TARGET_AVX512 inline __m512i majority(const __m512i x, const __m512i y, const __m512i z)
+	{
+		return _mm512_ternarylogic_epi64(x, y, z, 0xE8);
+	}
+}
+
+// One round of SHA-512 in every lane, and the message schedule word that it needs.
+// The working variables are passed rotated by one position for every round
+// (like in sha512_avx2.cpp) and "message_schedule" is a ring of the last 16 words.
+#define CRYPTB_SHA512_MULTI_ROUND(a, b, c, d, e, f, g, h, word_index) \
+	{ \
+		if ((word_index) >= 16) \
+		{ \
+			const auto back15 = message_schedule[((word_index) - 15) % 16]; \
+			const auto back2 = message_schedule[((word_index) - 2) % 16]; \
+			message_schedule[(word_index) % 16] = add( \
+				add(message_schedule[(word_index) % 16], message_schedule[((word_index) - 7) % 16]), \
+				add(xor3(rotate_right<1>(back15), rotate_right<8>(back15), shift_right<7>(back15)), \
+					xor3(rotate_right<19>(back2), rotate_right<61>(back2), shift_right<6>(back2)))); \
+		} \
+		const auto T1 = add( \
+			add(h, xor3(rotate_right<14>(e), rotate_right<18>(e), rotate_right<41>(e))), \
+			add(choice(e, f, g), add(broadcast(e, sha512::round_constants[(word_index)]), message_schedule[(word_index) % 16]))); \
+		const auto T2 = add(xor3(rotate_right<28>(a), rotate_right<34>(a), rotate_right<39>(a)), majority(a, b, c)); \
+		d = add(d, T1); \
+		h = add(T1, T2); \
+	}
+
+#define CRYPTB_SHA512_MULTI_ROUNDS \
+	for (int word_index = 0; word_index < 80; word_index += 8) \
+	{ \
+		CRYPTB_SHA512_MULTI_ROUND(a, b, c, d, e, f, g, h, word_index + 0); \
+		CRYPTB_SHA512_MULTI_ROUND(h, a, b, c, d, e, f, g, word_index + 1); \
+		CRYPTB_SHA512_MULTI_ROUND(g, h, a, b, c, d, e, f, word_index + 2); \
+		CRYPTB_SHA512_MULTI_ROUND(f, g, h, a, b, c, d, e, word_index + 3); \
+		CRYPTB_SHA512_MULTI_ROUND(e, f, g, h, a, b, c, d, word_index + 4); \
+		CRYPTB_SHA512_MULTI_ROUND(d, e, f, g, h, a, b, c, word_index + 5); \
+		CRYPTB_SHA512_MULTI_ROUND(c, d, e, f, g, h, a, b, word_index + 6); \
+		CRYPTB_SHA512_MULTI_ROUND(b, c, d, e, f, g, h, a, word_index + 7); \
+	}
+
+CRYPTB_TARGET_AVX2 void cryptb::sha512_multi::compress_lanes(lanes_state_t<4>& state, const lanes_block_t<4>& blocks)
+{
+	__m256i message_schedule[16];
+	for (int word_index = 0; word_index < 16; ++word_index)
+	{
+		message_schedule[word_index] = _mm256_load_si256(reinterpret_cast<const __m256i*>(blocks[word_index]));
+	}
+	__m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[0]));
+	__m256i b = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[1]));
+	__m256i c = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[2]));
+	__m256i d = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[3]));
+	__m256i e = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[4]));
+	__m256i f = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[5]));
+	__m256i g = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[6]));
+	__m256i h = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[7]));
+	CRYPTB_SHA512_MULTI_ROUNDS
+	_mm256_store_si256(reinterpret_cast<__m256i*>(state[0]), add(a, _mm256_load_si256(reinterpret_cast<const __m256i*>(state[0]))));
+	_mm256_store_si256(reinterpret_cast<__m256i*>(state[1]), add(b, _mm256_load_si256(reinterpret_cast<const __m256i*>(state[1]))));
+	_mm256_store_si256(reinterpret_cast<__m256i*>(state[2]), add(c, _mm256_load_si256(reinterpret_cast<const __m256i*>(state[2]))));
+	_mm256_store_si256(reinterpret_cast<__m256i*>(state[3]), add(d, _mm256_load_si256(reinterpret_cast<const __m256i*>(state[3]))));
+	_mm256_store_si256(reinterpret_cast<__m256i*>(state[4]), add(e, _mm256_load_si256(reinterpret_cast<const __m256i*>(state[4]))));
+	_mm256_store_si256(reinterpret_cast<__m256i*>(state[5]), add(f, _mm256_load_si256(reinterpret_cast<const __m256i*>(state[5]))));
+	_mm256_store_si256(reinterpret_cast<__m256i*>(state[6]), add(g, _mm256_load_si256(reinterpret_cast<const __m256i*>(state[6]))));
+	_mm256_store_si256(reinterpret_cast<__m256i*>(state[7]), add(h, _mm256_load_si256(reinterpret_cast<const __m256i*>(state[7]))));
+}
+
+CRYPTB_TARGET_AVX512 void cryptb::sha512_multi::compress_lanes(lanes_state_t<8>& state, const lanes_block_t<8>& blocks)
+{
+	__m512i message_schedule[16];
+	for (int word_index = 0; word_index < 16; ++word_index)
+	{
+		message_schedule[word_index] = _mm512_load_si512(blocks[word_index]);
+	}
+	__m512i a = _mm512_load_si512(state[0]);
+	__m512i b = _mm512_load_si512(state[1]);
+	__m512i c = _mm512_load_si512(state[2]);
+	__m512i d = _mm512_load_si512(state[3]);
+	__m512i e = _mm512_load_si512(state[4]);
+	__m512i f = _mm512_load_si512(state[5]);
+	__m512i g = _mm512_load_si512(state[6]);
+	__m512i h = _mm512_load_si512(state[7]);
+	CRYPTB_SHA512_MULTI_ROUNDS
+	_mm512_store_si512(state[0], add(a, _mm512_load_si512(state[0])));
+	_mm512_store_si512(state[1], add(b, _mm512_load_si512(state[1])));
+	_mm512_store_si512(state[2], add(c, _mm512_load_si512(state[2])));
+	_mm512_store_si512(state[3], add(d, _mm512_load_si512(state[3])));
+	_mm512_store_si512(state[4], add(e, _mm512_load_si512(state[4])));
+	_mm512_store_si512(state[5], add(f, _mm512_load_si512(state[5])));
+	_mm512_store_si512(state[6], add(g, _mm512_load_si512(state[6])));
+	_mm512_store_si512(state[7], add(h, _mm512_load_si512(state[7])));
+}
+
+#undef CRYPTB_SHA512_MULTI_ROUNDS
+#undef CRYPTB_SHA512_MULTI_ROUND
+
+#else
+
+// Not x86-64. is_supported() is false for both, so these are never called.
+
+void cryptb::sha512_multi::compress_lanes(lanes_state_t<4>&, const lanes_block_t<4>&)
+{
+	throw std::logic_error("Error in function \"sha512_multi::compress_lanes\". AVX2 isn\'t available.");
+}
+
+void cryptb::sha512_multi::compress_lanes(lanes_state_t<8>&, const lanes_block_t<8>&)
+{
+	throw std::logic_error("Error in function \"sha512_multi::compress_lanes\". AVX-512 isn\'t available.");
+}
+
+#endif
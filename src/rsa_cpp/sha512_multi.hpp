@@ -0,0 +1,74 @@
+#pragma once
+
+#include "sha512.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace cryptb
+{
+	// Hashes many independent messages at the same time, one message in every SIMD lane:
+	// 8 lanes with AVX-512, 4 lanes with AVX2, and one message at a time with sha512 otherwise.
+	//
+	// A single SHA-512 can't use more than one lane because every message block depends
+	// on the previous one, so this is the way to go for lots of small messages.
+	// Messages don't need to be the same length. When a lane finishes its message
+	// it's refilled with the next message that hasn't been started yet,
+	// so one long message doesn't leave the other lanes idle.
+	class sha512_multi
+	{
+	public:
+		struct message
+		{
+			// Can only be nullptr when "len" == 0
+			const std::uint8_t* data = nullptr;
+			std::size_t len = 0;
+		};
+
+		enum class implementation
+		{
+			// One message at a time with sha512
+			scalar,
+			// 4 lanes
+			avx2,
+			// 8 lanes
+			avx512
+		};
+
+		static bool is_supported(const implementation impl);
+
+		// The best implementation that the CPU supports
+		static implementation get_default_implementation();
+
+		// digests[index] = sha512(messages[index].data, messages[index].len).digest()
+		// (an empty message gets the digest of sha512{})
+		//
+		// "digests" must have the same size as "messages", otherwise std::invalid_argument is thrown.
+		static void digest(std::span<const message> messages, std::span<sha512::digest_t> digests);
+
+		// Same but with a specific implementation, for cross-checking and benchmarking.
+		// Throws std::invalid_argument if the CPU doesn't support "impl".
+		static void digest(std::span<const message> messages, std::span<sha512::digest_t> digests, const implementation impl);
+
+	private:
+		// The lanes are stored "transposed": [word index][lane index]
+		// so that loading one word of all of the lanes is a single vector load.
+		template <int num_lanes>
+		using lanes_state_t = std::uint64_t[8][num_lanes];
+		template <int num_lanes>
+		using lanes_block_t = std::uint64_t[16][num_lanes];
+
+		// Runs the messages through the lanes, refilling every lane that finishes.
+		template <int num_lanes>
+		static void digest_in_lanes(std::span<const message> messages, std::span<sha512::digest_t> digests);
+
+		// Block number "block_index" of the padded "msg" into lane "lane_index" of "blocks"
+		template <int num_lanes>
+		static void load_block(const message& msg, const std::size_t block_index, lanes_block_t<num_lanes>& blocks, const int lane_index);
+
+		// One sha512::compress in every lane.
+		// 4 lanes is AVX2 and 8 lanes is AVX-512, only call when the CPU supports the instructions.
+		static void compress_lanes(lanes_state_t<4>& state, const lanes_block_t<4>& blocks);
+		static void compress_lanes(lanes_state_t<8>& state, const lanes_block_t<8>& blocks);
+	};
+}
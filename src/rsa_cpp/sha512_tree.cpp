@@ -0,0 +1,106 @@
+#include "sha512_tree.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <boost/endian/conversion.hpp>
+
+namespace
+{
+	// Domain separation between the leaves and the root
+	constexpr std::uint8_t leaf_prefix = 0x00;
+	constexpr std::uint8_t root_prefix = 0x01;
+	constexpr char construction_tag[] = "cryptb-sha512-tree-v1";
+}
+
+cryptb::sha512_tree::sha512_tree(const std::size_t leaf_size)
+	: m_leaf_size(leaf_size)
+{
+	if (leaf_size == 0)
+	{
+		throw std::invalid_argument("Error in function \"cryptb::sha512_tree::sha512_tree\"."
+			" \"leaf_size\" can\'t be 0.");
+	}
+}
+
+cryptb::sha512::digest_t cryptb::sha512_tree::hash_leaf(std::span<const std::uint8_t> leaf)
+{
+	sha512 hash{ &leaf_prefix, 1 };
+	if (!leaf.empty())
+		hash.update(leaf.data(), leaf.size());
+	return hash.digest();
+}
+
+void cryptb::sha512_tree::hash_leaves(std::span<const std::uint8_t> data, const std::size_t first_leaf, const std::size_t last_leaf, thread_pool& pool)
+{
+	if (first_leaf >= last_leaf)
+		return;
+	pool.parallel_for(last_leaf - first_leaf, [this, data, first_leaf](const std::size_t index) -> void
+	{
+		const std::size_t leaf_index = first_leaf + index;
+		const std::size_t offset = leaf_index * this->m_leaf_size;
+		const std::size_t leaf_len = std::min(this->m_leaf_size, data.size() - offset);
+		this->m_leaf_digests[leaf_index] = sha512_tree::hash_leaf(data.subspan(offset, leaf_len));
+	});
+}
+
+void cryptb::sha512_tree::assign(std::span<const std::uint8_t> data, thread_pool& pool)
+{
+	const std::size_t num_leaves = (data.size() + this->m_leaf_size - 1) / this->m_leaf_size;
+	this->m_leaf_digests.assign(num_leaves, sha512::digest_t{});
+	this->m_total_size = data.size();
+	this->hash_leaves(data, 0, num_leaves, pool);
+}
+
+void cryptb::sha512_tree::rehash_range(std::span<const std::uint8_t> data, const std::size_t changed_offset, const std::size_t changed_len, thread_pool& pool)
+{
+	if (changed_offset > data.size() || changed_len > data.size() - changed_offset)
+	{
+		throw std::invalid_argument("Error in function \"cryptb::sha512_tree::rehash_range\"."
+			" The changed range must be inside of \"data\".");
+	}
+	const std::size_t num_leaves = (data.size() + this->m_leaf_size - 1) / this->m_leaf_size;
+	this->m_leaf_digests.resize(num_leaves);
+
+	// The leaves that the changed range touches
+	const std::size_t first_changed_leaf = changed_offset / this->m_leaf_size;
+	const std::size_t last_changed_leaf = changed_len == 0
+		? first_changed_leaf
+		: (changed_offset + changed_len - 1) / this->m_leaf_size + 1;
+	// When the size changed: the old last leaf might have been partial, and everything after it is new.
+	const std::size_t first_resized_leaf = data.size() == this->m_total_size
+		? num_leaves
+		: std::min<std::uint64_t>(data.size(), this->m_total_size) / this->m_leaf_size;
+	this->m_total_size = data.size();
+
+	if (first_changed_leaf < last_changed_leaf && last_changed_leaf >= first_resized_leaf)
+	{
+		// The two ranges overlap or touch
+		this->hash_leaves(data, std::min(first_changed_leaf, first_resized_leaf), num_leaves, pool);
+	}
+	else
+	{
+		this->hash_leaves(data, first_changed_leaf, last_changed_leaf, pool);
+		this->hash_leaves(data, first_resized_leaf, num_leaves, pool);
+	}
+}
+
+cryptb::sha512::digest_t cryptb::sha512_tree::digest() const
+{
+	sha512 hash{ &root_prefix, 1 };
+	hash.update(reinterpret_cast<const std::uint8_t*>(construction_tag), sizeof(construction_tag) - 1);
+	std::uint8_t sizes[16]{};
+	boost::endian::store_big_u64(sizes, static_cast<std::uint64_t>(this->m_leaf_size));
+	boost::endian::store_big_u64(sizes + 8, this->m_total_size);
+	hash.update(sizes, sizeof(sizes));
+	for (const sha512::digest_t& leaf_digest : this->m_leaf_digests)
+	{
+		hash.update(leaf_digest.data(), leaf_digest.size());
+	}
+	return hash.digest();
+}
+
+cryptb::sha512::digest_t cryptb::sha512_tree::hash(std::span<const std::uint8_t> data, thread_pool& pool, const std::size_t leaf_size)
+{
+	sha512_tree tree{ leaf_size };
+	tree.assign(data, pool);
+	return tree.digest();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "sha512.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace cryptb
+{
+	// Tree hashing with SHA-512, for inputs that are too large to hash on one core.
+	//
+	// The input is split into leaves of "leaf_size" bytes (the last one can be shorter)
+	// and the leaves are hashed in parallel on a thread_pool:
+	//	leaf_digest[i] = SHA-512(0x00 || leaf i)
+	// The result is the hash of all of the leaf digests:
+	//	digest = SHA-512(0x01 || "cryptb-sha512-tree-v1" || leaf_size || total_size || leaf_digest[0] || leaf_digest[1] || ...)
+	// where leaf_size and total_size are 64-bit big-endian.
+	//
+	// THE DIGEST IS NOT THE SHA-512 OF THE INPUT, it's a different construction.
+	// Both sides have to agree on using sha512_tree (and on the leaf size).
+	// The prefix bytes make it impossible to pass a leaf digest off as a tree digest or the other way around.
+	//
+	// The leaf digests are kept, so when only part of the input changes
+	// only the leaves that it touches have to be hashed again (see "rehash_range").
+	class sha512_tree
+	{
+		std::size_t m_leaf_size = 0;
+		std::uint64_t m_total_size = 0;
+		std::vector<sha512::digest_t> m_leaf_digests;
+
+		static sha512::digest_t hash_leaf(std::span<const std::uint8_t> leaf);
+		// Hashes the leaves [first_leaf, last_leaf) of "data" into m_leaf_digests
+		void hash_leaves(std::span<const std::uint8_t> data, const std::size_t first_leaf, const std::size_t last_leaf, thread_pool& pool);
+
+	public:
+		static constexpr std::size_t default_leaf_size = 1 << 20;
+
+		// Throws std::invalid_argument if "leaf_size" is 0.
+		explicit sha512_tree(const std::size_t leaf_size = default_leaf_size);
+
+		// Hashes all of "data" from scratch.
+		void assign(std::span<const std::uint8_t> data, thread_pool& pool);
+
+		// "data" is the new version of the input that was last given to "assign" / "rehash_range",
+		// and only the bytes [changed_offset, changed_offset + changed_len) are different.
+		// The size of "data" is allowed to change too, then every leaf from the old end
+		// or the new end (whichever comes first) is hashed again as well.
+		//
+		// Gives the same digest as "assign(data, pool)" would, when the promise about what changed is true.
+		void rehash_range(std::span<const std::uint8_t> data, const std::size_t changed_offset, const std::size_t changed_len, thread_pool& pool);
+
+		sha512::digest_t digest() const;
+
+		std::size_t get_leaf_size() const
+		{
+			return this->m_leaf_size;
+		}
+
+		const std::vector<sha512::digest_t>& get_leaf_digests() const
+		{
+			return this->m_leaf_digests;
+		}
+
+		// One-shot version of "assign" followed by "digest".
+		static sha512::digest_t hash(std::span<const std::uint8_t> data, thread_pool& pool, const std::size_t leaf_size = default_leaf_size);
+	};
+}
@@ -0,0 +1,166 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+// Which pool (if any) the current thread is a worker of, and which worker it is.
+// Lets "submit" push to the current worker's own queue.
+static thread_local const cryptb::thread_pool* current_pool = nullptr;
+static thread_local std::size_t current_worker_index = 0;
+
+cryptb::thread_pool::thread_pool(const int num_threads)
+{
+	if (num_threads < 0)
+	{
+		throw std::invalid_argument("Error in function \"cryptb::thread_pool::thread_pool\"."
+			" \"num_threads\" can\'t be negative.");
+	}
+	const int total_threads = num_threads == 0
+		? std::max<int>(1, static_cast<int>(std::thread::hardware_concurrency()))
+		: num_threads;
+	this->m_queues.reserve(total_threads);
+	for (int index = 0; index < total_threads; ++index)
+	{
+		this->m_queues.push_back(std::make_unique<worker_queue>());
+	}
+	this->m_threads.reserve(total_threads);
+	for (int index = 0; index < total_threads; ++index)
+	{
+		this->m_threads.emplace_back(&thread_pool::worker_loop, this, static_cast<std::size_t>(index));
+	}
+}
+
+cryptb::thread_pool::~thread_pool()
+{
+	{
+		const std::lock_guard<std::mutex> lock{ this->m_sleep_mutex };
+		this->m_stopping = true;
+	}
+	this->m_wake.notify_all();
+	for (std::thread& thread : this->m_threads)
+	{
+		thread.join();
+	}
+}
+
+void cryptb::thread_pool::submit(task_t task)
+{
+	const std::size_t index = current_pool == this
+		? current_worker_index
+		: this->m_next_queue.fetch_add(1, std::memory_order_relaxed) % this->m_queues.size();
+	{
+		worker_queue& queue = *this->m_queues[index];
+		const std::lock_guard<std::mutex> lock{ queue.mutex };
+		queue.tasks.push_back(std::move(task));
+	}
+	{
+		// Incremented under the sleep mutex so that a worker that's
+		// about to go to sleep can't miss it.
+		const std::lock_guard<std::mutex> lock{ this->m_sleep_mutex };
+		this->m_num_queued.fetch_add(1, std::memory_order_relaxed);
+	}
+	this->m_wake.notify_one();
+}
+
+bool cryptb::thread_pool::try_run_one(const std::size_t preferred_queue)
+{
+	task_t task;
+	const std::size_t num_queues = this->m_queues.size();
+	for (std::size_t offset = 0; offset < num_queues && !task; ++offset)
+	{
+		worker_queue& queue = *this->m_queues[(preferred_queue + offset) % num_queues];
+		const std::lock_guard<std::mutex> lock{ queue.mutex };
+		if (queue.tasks.empty())
+			continue;
+		if (offset == 0)
+		{
+			// Own queue: newest first
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else
+		{
+			// Stealing: oldest first
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		this->m_num_queued.fetch_sub(1, std::memory_order_relaxed);
+	}
+	if (!task)
+		return false;
+	task();
+	return true;
+}
+
+void cryptb::thread_pool::worker_loop(const std::size_t index)
+{
+	current_pool = this;
+	current_worker_index = index;
+	while (true)
+	{
+		if (this->try_run_one(index))
+			continue;
+		std::unique_lock<std::mutex> lock{ this->m_sleep_mutex };
+		this->m_wake.wait(lock, [this]() -> bool
+		{
+			return this->m_stopping || this->m_num_queued.load(std::memory_order_relaxed) > 0;
+		});
+		if (this->m_stopping && this->m_num_queued.load(std::memory_order_relaxed) == 0)
+			return;
+	}
+}
+
+void cryptb::thread_pool::parallel_for(const std::size_t count, const std::function<void(std::size_t)>& body)
+{
+	if (count == 0)
+		return;
+	struct shared_state
+	{
+		std::atomic<std::size_t> num_remaining{ 0 };
+		std::mutex mutex;
+		std::condition_variable done;
+		std::exception_ptr error;
+	};
+	// Lives on this stack frame. That's safe because this function
+	// doesn't return before every task is done with it.
+	shared_state state;
+	state.num_remaining.store(count, std::memory_order_relaxed);
+	for (std::size_t index = 0; index < count; ++index)
+	{
+		this->submit([&state, &body, index]() -> void
+		{
+			try
+			{
+				body(index);
+			}
+			catch (...)
+			{
+				const std::lock_guard<std::mutex> lock{ state.mutex };
+				if (!state.error)
+					state.error = std::current_exception();
+			}
+			// Under the lock, so that "state" can't go out of scope
+			// before this task is completely done with it.
+			const std::lock_guard<std::mutex> lock{ state.mutex };
+			if (state.num_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				state.done.notify_all();
+		});
+	}
+	const std::size_t preferred_queue = current_pool == this ? current_worker_index : 0;
+	while (state.num_remaining.load(std::memory_order_acquire) > 0)
+	{
+		if (this->try_run_one(preferred_queue))
+			continue;
+		// Nothing left to steal, the rest of the tasks are running on other threads.
+		std::unique_lock<std::mutex> lock{ state.mutex };
+		state.done.wait(lock, [&state]() -> bool
+		{
+			return state.num_remaining.load(std::memory_order_acquire) == 0;
+		});
+	}
+	// Wait for the last task to let go of the lock.
+	const std::lock_guard<std::mutex> lock{ state.mutex };
+	if (state.error)
+		std::rethrow_exception(state.error);
+}
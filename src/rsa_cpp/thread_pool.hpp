@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cryptb
+{
+	// Fixed-size pool of worker threads with work stealing.
+	//
+	// Every worker has its own queue of tasks. A worker runs the newest task
+	// from its own queue first (it's the most likely to still be in the cache),
+	// and when its queue is empty it steals the oldest task from another worker's queue.
+	// Tasks submitted from outside of the pool are spread over the queues round-robin.
+	//
+	// Long private-key operations (one RSA signature is milliseconds) don't need
+	// anything fancier than that.
+	class thread_pool
+	{
+	public:
+		using task_t = std::function<void()>;
+
+	private:
+		struct worker_queue
+		{
+			std::mutex mutex;
+			std::deque<task_t> tasks;
+		};
+
+		std::vector<std::unique_ptr<worker_queue>> m_queues;
+		std::vector<std::thread> m_threads;
+		// Tasks that were submitted but not yet taken out of a queue
+		std::atomic<std::size_t> m_num_queued{ 0 };
+		std::atomic<std::size_t> m_next_queue{ 0 };
+		std::mutex m_sleep_mutex;
+		std::condition_variable m_wake;
+		bool m_stopping = false;
+
+		// Runs one task if there's any. Looks at "preferred_queue" first.
+		bool try_run_one(const std::size_t preferred_queue);
+		void worker_loop(const std::size_t index);
+
+	public:
+		// "num_threads" == 0 uses std::thread::hardware_concurrency() threads.
+		explicit thread_pool(const int num_threads = 0);
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+		// Finishes all of the tasks that were already submitted.
+		~thread_pool();
+
+		int size() const
+		{
+			return static_cast<int>(this->m_threads.size());
+		}
+
+		// Runs "task" on one of the workers at some point.
+		// "task" must not throw.
+		void submit(task_t task);
+
+		// Calls body(index) for every index in [0, count) on the pool
+		// and waits for all of them to finish.
+		// The calling thread helps with the work while it waits, so it's
+		// fine to call this from inside of a task that runs on the pool.
+		// If any of the calls throws, the first exception is rethrown after
+		// all of the others finished.
+		void parallel_for(const std::size_t count, const std::function<void(std::size_t)>& body);
+	};
+}
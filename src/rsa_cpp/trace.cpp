@@ -0,0 +1,275 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Size of every thread's ring buffer of recent events (for write_chrome_trace)
+	constexpr std::size_t max_events_per_thread = 1 << 16;
+
+	using cryptb::trace::histogram;
+	using cryptb::trace::num_events;
+
+	// Everything one thread recorded. Only that thread writes to it, so plain relaxed
+	// loads and stores are enough (no read-modify-write), the atomics are only there
+	// so that the dumps can read it at the same time.
+	struct thread_buffer
+	{
+		std::uint64_t thread_index = 0;
+		std::array<std::array<std::atomic<std::uint64_t>, histogram::num_buckets>, num_events> counts{};
+		std::array<std::atomic<std::uint64_t>, num_events> sums{};
+		std::array<std::atomic<std::uint64_t>, num_events> maxes{};
+		// The start of every event, and its duration shifted left by 8 with the event in the low byte.
+		// Event number "index" is at "index" % max_events_per_thread.
+		std::unique_ptr<std::atomic<std::uint64_t>[]> starts = std::make_unique<std::atomic<std::uint64_t>[]>(max_events_per_thread);
+		std::unique_ptr<std::atomic<std::uint64_t>[]> durations = std::make_unique<std::atomic<std::uint64_t>[]>(max_events_per_thread);
+		std::atomic<std::uint64_t> num_recorded{ 0 };
+	};
+
+	void increase(std::atomic<std::uint64_t>& value, const std::uint64_t amount)
+	{
+		value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	// The buffers outlive their threads so that the dumps still see what exited threads recorded.
+	struct registry
+	{
+		std::mutex mutex;
+		std::vector<std::shared_ptr<thread_buffer>> buffers;
+		std::uint64_t num_threads = 0;
+	};
+
+	registry& get_registry()
+	{
+		static registry instance;
+		return instance;
+	}
+
+	// Created and registered on the thread's first event, that's the only time a lock is taken.
+	thread_buffer& local_buffer()
+	{
+		thread_local const std::shared_ptr<thread_buffer> buffer = []() -> std::shared_ptr<thread_buffer>
+		{
+			std::shared_ptr<thread_buffer> created = std::make_shared<thread_buffer>();
+			registry& instance = get_registry();
+			const std::lock_guard<std::mutex> lock{ instance.mutex };
+			created->thread_index = instance.num_threads++;
+			instance.buffers.push_back(created);
+			return created;
+		}();
+		return *buffer;
+	}
+
+	std::vector<std::shared_ptr<thread_buffer>> get_buffers()
+	{
+		registry& instance = get_registry();
+		const std::lock_guard<std::mutex> lock{ instance.mutex };
+		return instance.buffers;
+	}
+}
+
+const char* cryptb::trace::get_name(const event traced_event)
+{
+	switch (traced_event)
+	{
+	case event::sha512_compress:
+		return "sha512_compress";
+	case event::rsa_powm_public:
+		return "rsa_powm_public";
+	case event::rsa_powm_private:
+		return "rsa_powm_private";
+	case event::miller_rabin_test:
+		return "miller_rabin_test";
+	default:
+		return "unknown";
+	}
+}
+
+std::uint64_t cryptb::trace::now_nanoseconds()
+{
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+void cryptb::trace::record(const event traced_event, const std::uint64_t start_nanoseconds, const std::uint64_t duration_nanoseconds)
+{
+	const std::size_t event_index = static_cast<std::size_t>(traced_event);
+	if (event_index >= num_events)
+		return;
+	thread_buffer& buffer = local_buffer();
+	increase(buffer.counts[event_index][histogram::bucket_of(duration_nanoseconds)], 1);
+	increase(buffer.sums[event_index], duration_nanoseconds);
+	if (duration_nanoseconds > buffer.maxes[event_index].load(std::memory_order_relaxed))
+		buffer.maxes[event_index].store(duration_nanoseconds, std::memory_order_relaxed);
+
+	const std::uint64_t index = buffer.num_recorded.load(std::memory_order_relaxed);
+	buffer.starts[index % max_events_per_thread].store(start_nanoseconds, std::memory_order_relaxed);
+	buffer.durations[index % max_events_per_thread].store((duration_nanoseconds << 8) | event_index, std::memory_order_relaxed);
+	// Release: whoever sees the new count also sees the event
+	buffer.num_recorded.store(index + 1, std::memory_order_release);
+}
+
+std::size_t cryptb::trace::histogram::bucket_of(const std::uint64_t value)
+{
+	constexpr std::uint64_t sub_bucket_count = std::uint64_t{ 1 } << sub_bucket_bits;
+	if (value < sub_bucket_count)
+		return static_cast<std::size_t>(value);
+	// Index of the most significant bit, >= sub_bucket_bits here
+	const int msb = 63 - std::countl_zero(value);
+	const int shift = msb - sub_bucket_bits;
+	return static_cast<std::size_t>(msb - sub_bucket_bits + 1) * sub_bucket_count
+		+ static_cast<std::size_t>((value >> shift) & (sub_bucket_count - 1));
+}
+
+std::uint64_t cryptb::trace::histogram::highest_value_of(const std::size_t bucket)
+{
+	constexpr std::uint64_t sub_bucket_count = std::uint64_t{ 1 } << sub_bucket_bits;
+	if (bucket < sub_bucket_count)
+		return bucket;
+	const int shift = static_cast<int>(bucket / sub_bucket_count) - 1;
+	const std::uint64_t lowest = (sub_bucket_count + bucket % sub_bucket_count) << shift;
+	return lowest + ((std::uint64_t{ 1 } << shift) - 1);
+}
+
+void cryptb::trace::histogram::add(const std::uint64_t value)
+{
+	++this->counts[histogram::bucket_of(value)];
+	++this->count;
+	this->sum += value;
+	this->max = std::max(this->max, value);
+}
+
+cryptb::trace::histogram& cryptb::trace::histogram::operator+=(const histogram& other)
+{
+	for (std::size_t bucket = 0; bucket < num_buckets; ++bucket)
+	{
+		this->counts[bucket] += other.counts[bucket];
+	}
+	this->count += other.count;
+	this->sum += other.sum;
+	this->max = std::max(this->max, other.max);
+	return *this;
+}
+
+std::uint64_t cryptb::trace::histogram::value_at_percentile(const double percentile) const
+{
+	if (this->count == 0)
+		return 0;
+	const double clamped = std::clamp(percentile, 0.0, 100.0);
+	const std::uint64_t rank = std::max<std::uint64_t>(1,
+		static_cast<std::uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(this->count))));
+	std::uint64_t seen = 0;
+	for (std::size_t bucket = 0; bucket < num_buckets; ++bucket)
+	{
+		seen += this->counts[bucket];
+		if (seen >= rank)
+			return std::min(histogram::highest_value_of(bucket), this->max);
+	}
+	return this->max;
+}
+
+std::array<cryptb::trace::histogram, cryptb::trace::num_events> cryptb::trace::get_histograms()
+{
+	std::array<histogram, num_events> result{};
+	for (const std::shared_ptr<thread_buffer>& buffer : get_buffers())
+	{
+		for (std::size_t event_index = 0; event_index < num_events; ++event_index)
+		{
+			histogram& current = result[event_index];
+			for (std::size_t bucket = 0; bucket < histogram::num_buckets; ++bucket)
+			{
+				const std::uint64_t count = buffer->counts[event_index][bucket].load(std::memory_order_relaxed);
+				current.counts[bucket] += count;
+				current.count += count;
+			}
+			current.sum += buffer->sums[event_index].load(std::memory_order_relaxed);
+			current.max = std::max(current.max, buffer->maxes[event_index].load(std::memory_order_relaxed));
+		}
+	}
+	return result;
+}
+
+void cryptb::trace::write_percentiles(std::ostream& out)
+{
+	const std::array<histogram, num_events> histograms = trace::get_histograms();
+	out << std::left << std::setw(20) << "event" << std::right
+		<< std::setw(12) << "count"
+		<< std::setw(12) << "mean_ns"
+		<< std::setw(12) << "p50_ns"
+		<< std::setw(12) << "p90_ns"
+		<< std::setw(12) << "p99_ns"
+		<< std::setw(12) << "p99.9_ns"
+		<< std::setw(12) << "max_ns" << '\n';
+	for (std::size_t event_index = 0; event_index < num_events; ++event_index)
+	{
+		const histogram& current = histograms[event_index];
+		out << std::left << std::setw(20) << trace::get_name(static_cast<event>(event_index)) << std::right
+			<< std::setw(12) << current.count
+			<< std::setw(12) << (current.count == 0 ? 0 : current.sum / current.count)
+			<< std::setw(12) << current.value_at_percentile(50)
+			<< std::setw(12) << current.value_at_percentile(90)
+			<< std::setw(12) << current.value_at_percentile(99)
+			<< std::setw(12) << current.value_at_percentile(99.9)
+			<< std::setw(12) << current.max << '\n';
+	}
+}
+
+void cryptb::trace::write_chrome_trace(std::ostream& out)
+{
+	// Complete events ("ph": "X") with the times in microseconds, as the format wants them
+	auto microseconds = [](const std::uint64_t nanoseconds) -> std::string
+	{
+		std::string result = std::to_string(nanoseconds / 1000) + ".";
+		const std::string fraction = std::to_string(nanoseconds % 1000);
+		return result + std::string(3 - fraction.size(), '0') + fraction;
+	};
+	out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+	bool is_first = true;
+	for (const std::shared_ptr<thread_buffer>& buffer : get_buffers())
+	{
+		const std::uint64_t num_recorded = buffer->num_recorded.load(std::memory_order_acquire);
+		const std::uint64_t first = num_recorded > max_events_per_thread ? num_recorded - max_events_per_thread : 0;
+		for (std::uint64_t index = first; index < num_recorded; ++index)
+		{
+			const std::uint64_t start = buffer->starts[index % max_events_per_thread].load(std::memory_order_relaxed);
+			const std::uint64_t packed = buffer->durations[index % max_events_per_thread].load(std::memory_order_relaxed);
+			out << (is_first ? "\n" : ",\n");
+			is_first = false;
+			out << "{\"name\": \"" << trace::get_name(static_cast<event>(packed & 0xff)) << "\""
+				<< ", \"cat\": \"cryptb\", \"ph\": \"X\""
+				<< ", \"ts\": " << microseconds(start)
+				<< ", \"dur\": " << microseconds(packed >> 8)
+				<< ", \"pid\": 1, \"tid\": " << buffer->thread_index << "}";
+		}
+	}
+	out << "\n]}\n";
+}
+
+void cryptb::trace::reset()
+{
+	registry& instance = get_registry();
+	const std::lock_guard<std::mutex> lock{ instance.mutex };
+	// Drop the buffers of the threads that exited, only the registry still has them.
+	std::erase_if(instance.buffers, [](const std::shared_ptr<thread_buffer>& buffer) { return buffer.use_count() == 1; });
+	for (const std::shared_ptr<thread_buffer>& buffer : instance.buffers)
+	{
+		for (std::size_t event_index = 0; event_index < num_events; ++event_index)
+		{
+			for (std::atomic<std::uint64_t>& count : buffer->counts[event_index])
+			{
+				count.store(0, std::memory_order_relaxed);
+			}
+			buffer->sums[event_index].store(0, std::memory_order_relaxed);
+			buffer->maxes[event_index].store(0, std::memory_order_relaxed);
+		}
+		buffer->num_recorded.store(0, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Latency tracing of the hot paths (SHA-512 compression, the RSA exponentiations, Miller-Rabin).
+//
+// Off by default: CRYPTB_TRACE_SCOPE expands to nothing and there's no cost at all.
+// Configure with -DCRYPTB_WITH_TRACING=ON (which defines CRYPTB_WITH_TRACING) to turn it on.
+// Every traced call then costs two reads of std::chrono::steady_clock plus a few relaxed stores
+// into buffers of the calling thread (no locks, no allocation after the thread's first event).
+//
+// The results are dumped with cryptb::trace::write_percentiles or cryptb::trace::write_chrome_trace.
+
+namespace cryptb::trace
+{
+	// Every traced call site
+	enum class event : std::uint8_t
+	{
+		// One 128-byte block through sha512::compress (any implementation)
+		sha512_compress,
+		// powm with e (encrypt / is_valid_signature)
+		rsa_powm_public,
+		// powm with a private exponent, one per prime with CRT (decrypt / sign)
+		rsa_powm_private,
+		// One candidate through the primality test (see cryptb::primality_test)
+		miller_rabin_test,
+		num_events
+	};
+
+	constexpr std::size_t num_events = static_cast<std::size_t>(event::num_events);
+
+#ifdef CRYPTB_WITH_TRACING
+	constexpr bool is_enabled = true;
+#else
+	constexpr bool is_enabled = false;
+#endif
+
+	const char* get_name(const event traced_event);
+
+	// Nanoseconds since the first traced event of the process
+	std::uint64_t now_nanoseconds();
+
+	// Adds one call to the calling thread's histogram and to its recent events.
+	void record(const event traced_event, const std::uint64_t start_nanoseconds, const std::uint64_t duration_nanoseconds);
+
+	// Times its own lifetime. Use it through CRYPTB_TRACE_SCOPE.
+	class scope
+	{
+		const event m_event;
+		const std::uint64_t m_start;
+
+	public:
+		explicit scope(const event traced_event) : m_event(traced_event), m_start(now_nanoseconds()) {}
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+		~scope()
+		{
+			record(this->m_event, this->m_start, now_nanoseconds() - this->m_start);
+		}
+	};
+
+	// Log-linear buckets (like HdrHistogram): 16 buckets for every power of 2,
+	// so every value is known to within 1/16 (6.25%).
+	class histogram
+	{
+	public:
+		static constexpr int sub_bucket_bits = 4;
+		static constexpr std::size_t num_buckets = (64 - sub_bucket_bits + 1) << sub_bucket_bits;
+
+		static std::size_t bucket_of(const std::uint64_t value);
+		// The largest value that falls in "bucket"
+		static std::uint64_t highest_value_of(const std::size_t bucket);
+
+		std::array<std::uint64_t, num_buckets> counts{};
+		std::uint64_t count = 0;
+		std::uint64_t sum = 0;
+		std::uint64_t max = 0;
+
+		void add(const std::uint64_t value);
+		histogram& operator+=(const histogram& other);
+		// 0 <= "percentile" <= 100. Rounded up to the highest value of its bucket (but never above max).
+		std::uint64_t value_at_percentile(const double percentile) const;
+	};
+
+	// The histograms of all of the threads (including the ones that already exited) added up.
+	// Safe to call while other threads are tracing, the counts of calls that are being recorded
+	// right then may or may not be in it.
+	std::array<histogram, num_events> get_histograms();
+
+	// One line per event: count, mean, p50, p90, p99, p99.9 and max in nanoseconds
+	void write_percentiles(std::ostream& out);
+
+	// The most recent calls of every thread (up to "max_events_per_thread" each, see trace.cpp)
+	// in the Chrome trace event format: load the file in chrome://tracing or ui.perfetto.dev.
+	// Call it when the traced threads are quiet: an event that's written during the dump
+	// can come out with the start of one call and the duration of another.
+	void write_chrome_trace(std::ostream& out);
+
+	// Forgets everything that was recorded so far.
+	// Only call it when no other thread is tracing.
+	void reset();
+}
+
+#define CRYPTB_TRACE_CONCATENATE_IMPL(a, b) a##b
+#define CRYPTB_TRACE_CONCATENATE(a, b) CRYPTB_TRACE_CONCATENATE_IMPL(a, b)
+
+// Times the rest of the enclosing block as one "traced_event" (a cryptb::trace::event)
+#ifdef CRYPTB_WITH_TRACING
+#define CRYPTB_TRACE_SCOPE(traced_event) \
+	const ::cryptb::trace::scope CRYPTB_TRACE_CONCATENATE(cryptb_trace_scope_, __LINE__){ traced_event }
+#else
+#define CRYPTB_TRACE_SCOPE(traced_event) static_cast<void>(0)
+#endif